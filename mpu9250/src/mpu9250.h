@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * my-mpu9250 core <-> 버스 glue (mpu9250_i2c.c, mpu9250_spi.c) 인터페이스.
+ * 레지스터/IIO 처리는 전부 core, glue는 regmap과 버스트 읽기만 제공
+ */
+#ifndef _MY_MPU9250_H
+#define _MY_MPU9250_H
+
+#include <linux/atomic.h>
+#include <linux/regmap.h>
+
+struct device;
+
+/*
+ * 버스 계측 (debugfs my9250-<dev>/stats, tracepoint my9250_xfer/sample).
+ * 트랜잭션 분류는 시작 레지스터로: 데이터/FIFO/INT_STATUS = sample,
+ * 나머지 = config. regmap이 core probe 전에 만들어지므로 glue가 할당해서
+ * bus.stats로 넘기고, glue의 전송 함수가 my9250_bus_account()를 부름
+ */
+#define MY9250_LAT_BUCKETS        16  /* log2(us), 마지막 칸은 그 이상 전부 */
+
+enum my9250_xfer_kind {
+	MY9250_XFER_CONFIG,
+	MY9250_XFER_SAMPLE,
+	MY9250_XFER_NUM
+};
+
+struct my9250_bus_stats {
+	struct device *dev;
+	atomic64_t xfers[MY9250_XFER_NUM];
+	atomic64_t bytes[MY9250_XFER_NUM];   /* reg 바이트 + 데이터 (I2C 주소 바이트 제외) */
+	atomic64_t bus_ns[MY9250_XFER_NUM];
+	atomic64_t errors;
+	atomic64_t fifo_resets;  /* overflow로 버린 FIFO */
+	atomic64_t samples;      /* 읽어 온 샘플 (FIFO batch는 샘플 수만큼) */
+	atomic64_t lat[MY9250_LAT_BUCKETS];  /* IRQ/요청 -> 데이터 읽기 끝 */
+};
+
+struct my9250_bus {
+	struct regmap *regmap;
+	int irq;          /* INT(DRDY) 핀, 없으면 0 이하 */
+	bool is_spi;      /* core가 USER_CTRL.I2C_IF_DIS를 켬 */
+	/*
+	 * 센서 데이터/FIFO 버스트 읽기 (reg부터 len바이트, FIFO_R_W는 같은
+	 * 주소 반복). NULL이면 regmap_bulk_read/regmap_noinc_read.
+	 * buf는 core가 DMA-safe하게 잡아서 넘김
+	 */
+	int (*read_burst)(void *ctx, unsigned int reg, void *buf, size_t len);
+	void *ctx;
+	struct my9250_bus_stats *stats;
+};
+
+extern const struct regmap_config my9250_regmap_config;
+
+/* glue 전송 함수가 트랜잭션마다 호출. t0 = 시작 시각 (ktime_get_ns) */
+void my9250_bus_account(struct my9250_bus_stats *bs, bool write,
+			unsigned int reg, size_t len, u64 t0, int ret);
+
+int my9250_core_probe(struct device *dev, const struct my9250_bus *bus);
+
+#endif /* _MY_MPU9250_H */
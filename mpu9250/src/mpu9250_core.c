@@ -0,0 +1,1367 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * my-mpu9250 core: 레지스터, IIO 채널/버퍼/트리거, FIFO, AK8963,
+ * 자세(quaternion) 출력용 두 번째 IIO 장치. 버스 연결은 mpu9250_i2c.c / mpu9250_spi.c (my9250_core_probe 호출)
+ * 버스 계측: tracepoint (mpu9250_trace.h) + debugfs my9250-<dev>/stats
+ */
+#include <linux/module.h>
+#include <linux/bitfield.h>
+#include <linux/device.h>
+#include <linux/regmap.h>
+#include <linux/interrupt.h>
+#include <linux/hrtimer.h>
+#include <linux/mutex.h>
+#include <linux/delay.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/unaligned.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/sysfs.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/trigger.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
+
+#include "mpu9250.h"
+#include "mpu9250_fusion.h"
+
+#define CREATE_TRACE_POINTS
+#include "mpu9250_trace.h"
+
+#define MPU9250_WHO_AM_I          0x75
+#define MPU9250_WHO_AM_I_VAL      0x71
+#define MPU9250_PWR_MGMT_1        0x6B
+#define MPU9250_SMPLRT_DIV        0x19
+#define MPU9250_CONFIG            0x1A
+#define MPU9250_GYRO_CONFIG       0x1B
+#define MPU9250_ACCEL_CONFIG      0x1C
+#define MPU9250_ACCEL_CONFIG2     0x1D
+#define MPU9250_FIFO_EN           0x23
+#define MPU9250_I2C_MST_CTRL      0x24
+#define MPU9250_I2C_SLV0_ADDR     0x25
+#define MPU9250_I2C_SLV0_REG      0x26
+#define MPU9250_I2C_SLV0_CTRL     0x27
+#define MPU9250_I2C_SLV4_ADDR     0x31
+#define MPU9250_I2C_SLV4_REG      0x32
+#define MPU9250_I2C_SLV4_DO       0x33
+#define MPU9250_I2C_SLV4_CTRL     0x34
+#define MPU9250_I2C_SLV4_DI       0x35
+#define MPU9250_I2C_MST_STATUS    0x36
+#define MPU9250_INT_PIN_CFG       0x37
+#define MPU9250_INT_ENABLE        0x38
+#define MPU9250_INT_STATUS        0x3A
+#define MPU9250_I2C_MST_DELAY_CTRL 0x67
+#define MPU9250_SIGNAL_PATH_RESET 0x68
+#define MPU9250_USER_CTRL         0x6A
+#define MPU9250_FIFO_COUNTH       0x72
+#define MPU9250_FIFO_COUNTL       0x73
+#define MPU9250_FIFO_R_W          0x74
+#define MPU9250_EXT_SENS_DATA_23  0x60
+
+#define MPU9250_ACCEL_XOUT_H      0x3B
+#define MPU9250_TEMP_OUT_H        0x41
+#define MPU9250_GYRO_XOUT_H       0x43
+#define MPU9250_EXT_SENS_DATA_00  0x49
+
+#define MPU9250_FS_SEL_MASK       GENMASK(4, 3)  /* GYRO_CONFIG, ACCEL_CONFIG */
+#define MPU9250_DLPF_CFG_MASK     GENMASK(2, 0)  /* CONFIG */
+#define MPU9250_A_DLPF_MASK       GENMASK(3, 0)  /* ACCEL_CONFIG2: FCHOICE_B + A_DLPF_CFG */
+#define MPU9250_INT_RAW_RDY_EN    BIT(0)
+#define MPU9250_INT_FIFO_OFLOW    BIT(4)
+#define MPU9250_CONFIG_FIFO_MODE  BIT(6)  /* FIFO가 차면 더 쓰지 않음 */
+#define MPU9250_USER_FIFO_EN      BIT(6)
+#define MPU9250_USER_I2C_MST_EN   BIT(5)
+#define MPU9250_USER_I2C_IF_DIS   BIT(4)  /* SPI 전용: I2C 슬레이브 끔 */
+#define MPU9250_USER_FIFO_RST     BIT(2)
+/* TEMP | GYRO_X/Y/Z | ACCEL: FIFO에는 레지스터 순서(accel, temp, gyro)로 쌓임 */
+#define MPU9250_FIFO_EN_DATA      0xF8
+#define MPU9250_FIFO_EN_SLV0      BIT(0)  /* EXT_SENS_DATA(mag)가 gyro 뒤에 */
+
+#define MPU9250_I2C_MST_WAIT_ES   BIT(6)  /* ext sensor 읽기가 끝난 뒤 DRDY */
+#define MPU9250_I2C_MST_400KHZ    13
+#define MPU9250_I2C_SLV_READ      BIT(7)
+#define MPU9250_I2C_SLV_EN        BIT(7)
+#define MPU9250_I2C_SLV4_DONE     BIT(6)
+#define MPU9250_I2C_SLV4_NACK     BIT(4)
+#define MPU9250_I2C_DELAY_ES_SHADOW BIT(7)
+#define MPU9250_I2C_SLV0_DLY_EN   BIT(0)
+
+/* AK8963: MPU9250 내부의 magnetometer, 보조 I2C 버스의 0x0C */
+#define AK8963_ADDR               0x0C
+#define AK8963_WIA                0x00
+#define AK8963_WIA_VAL            0x48
+#define AK8963_HXL                0x03
+#define AK8963_CNTL1              0x0A
+#define AK8963_ASAX               0x10
+#define AK8963_ST2_HOFL           BIT(3)
+#define AK8963_MODE_POWER_DOWN    0x00
+#define AK8963_MODE_FUSE_ROM      0x0F
+#define AK8963_MODE_CONT_100HZ    0x06
+#define AK8963_BIT_16             BIT(4)
+#define AK8963_ODR_HZ             100
+/* 16비트 출력: 0.15uT/LSB = 0.0015 Gauss = 1500000 nano-Gauss */
+#define AK8963_SCALE_NGAUSS       1500000
+
+/*
+ * ACCEL_XOUT_H(0x3B) ~ GYRO_ZOUT_L(0x48): accel 6 + temp 2 + gyro 6.
+ * mag가 있으면 EXT_SENS_DATA_00..06(HXL..HZH, ST2) 7바이트가 이어짐:
+ * 한 번의 버스트로 9축
+ */
+#define MPU9250_DATA_LEN          14
+#define MPU9250_MAG_LEN           7
+#define MPU9250_DATA_MAX          (MPU9250_DATA_LEN + MPU9250_MAG_LEN)
+
+/*
+ * HW FIFO 512바이트 = 14바이트 샘플 36개 (mag 포함 21바이트면 24개).
+ * 타이머 지터 여유로 4샘플을 남겨 watermark 최대는 32 (mag 포함 20)
+ */
+#define MPU9250_FIFO_SIZE         512
+#define MPU9250_FIFO_WM_SLACK     4
+
+/*
+ * 내부 샘플 클럭 1kHz (DLPF_CFG 1..6일 때), ODR = 1kHz / (1 + SMPLRT_DIV).
+ * DLPF_CFG 0/7은 내부 8kHz라 분주 공식이 달라져서 사용하지 않음
+ */
+#define MPU9250_INTERNAL_HZ       1000
+#define MPU9250_SMPLRT_DIV_VAL    0
+#define MPU9250_DLPF_DEFAULT      3  /* gyro 41Hz, accel 44.8Hz */
+
+/* Mahony 게인 (Q16): Kp 1.0, Ki 0 (gyro bias 적분 안 함) */
+#define MY9250_FUSION_KP          (1 << 16)
+#define MY9250_FUSION_KI          0
+
+struct my9250_state {
+	struct device *dev;
+	struct regmap *regmap;
+	struct my9250_bus bus;
+	struct iio_dev *indio;
+	/*
+	 * 버퍼 모드: INT(DRDY) 핀이 있으면 그 IRQ, 없으면 ODR 주기 hrtimer.
+	 * watermark > 1이면 HW FIFO 모드: watermark 샘플마다 hrtimer로 한 번에
+	 * 비우고 INT는 끔 (FIFO overflow IRQ로 drain해도 이미 넘친 FIFO는
+	 * reset 외에 방법이 없음. overflow는 drain 때 감지해서 reset/집계)
+	 */
+	struct iio_trigger *trig;
+	struct hrtimer timer;
+	ktime_t period;
+	int odr_hz;
+	unsigned int watermark;
+	unsigned int watermark_max;
+	bool fifo_on;
+	s64 fifo_ts;  /* 직전 batch 마지막 샘플의 timestamp */
+
+	/* AK8963 (없으면 6축): 버스트/FIFO 샘플 길이와 축별 ASA 반영 scale */
+	bool has_mag;
+	unsigned int data_len;
+	int magn_scale[3];  /* nano-Gauss per LSB */
+	u8 mag_dly;         /* I2C_SLV4_CTRL.I2C_MST_DLY: ODR / (1 + dly)로 mag 읽기 */
+
+	/*
+	 * 자세 출력 장치 (my-mpu9250-orientation). 버퍼가 켜져 있는 동안 같은
+	 * trigger의 샘플마다 필터를 갱신하고 fusion_decim 샘플마다 하나를 내보냄
+	 */
+	struct iio_dev *orient;
+	struct my9250_fusion fusion;
+	unsigned int fusion_decim;
+	unsigned int fusion_cnt;
+	s64 fusion_ts;  /* 직전 샘플 timestamp, 0이면 첫 샘플 */
+
+	/*
+	 * sysfs read_raw용 최근 버스트 스냅샷. 같은 ODR 주기 안에서는 칩에
+	 * 새 샘플이 없으므로 축을 연달아 읽어도 버스를 다시 타지 않음
+	 */
+	struct mutex lock;
+	u64 snap_ns;
+	bool snap_valid;
+
+	/*
+	 * accel xyz, temp, gyro xyz (BE), mag xyz (LE): 레지스터 순서 그대로.
+	 * st2는 버스트 끝에 따라오는 AK8963 ST2 (버퍼로는 안 나감),
+	 * timestamp 위치는 iio_push_to_buffers_with_ts()가 scan mask로 정함
+	 */
+	struct {
+		__be16 chans[MPU9250_DATA_LEN / 2];
+		__le16 magn[3];
+		u8 st2;
+		s64 ts __aligned(8);
+	} scan __aligned(IIO_DMA_MINALIGN);
+
+	/* 버스트 읽기 대상: SPI DMA를 위해 각각 cache line 정렬 */
+	u8 snap[MPU9250_DATA_MAX] __aligned(IIO_DMA_MINALIGN);
+
+	/* quaternion w, x, y, z (Q30) */
+	struct {
+		s32 q[4];
+		s64 ts __aligned(8);
+	} qscan;
+	u8 fifo_buf[MPU9250_FIFO_SIZE] __aligned(IIO_DMA_MINALIGN);
+};
+
+/* FIFO_R_W는 주소 증가 없이 연속으로 읽어야 함 */
+static bool my9250_noinc_reg(struct device *dev, unsigned int reg)
+{
+	return reg == MPU9250_FIFO_R_W;
+}
+
+/* 측정값/상태와 스스로 클리어되는 비트가 있는 레지스터만 매번 버스에서 */
+static bool my9250_volatile_reg(struct device *dev, unsigned int reg)
+{
+	switch (reg) {
+	case MPU9250_INT_STATUS:
+	case MPU9250_ACCEL_XOUT_H ... MPU9250_EXT_SENS_DATA_23:
+	case MPU9250_SIGNAL_PATH_RESET:
+	case MPU9250_USER_CTRL:         /* FIFO_RST 등 */
+	case MPU9250_PWR_MGMT_1:        /* H_RESET */
+	case MPU9250_I2C_SLV4_CTRL:     /* I2C_SLV4_EN */
+	case MPU9250_I2C_SLV4_DI:
+	case MPU9250_I2C_MST_STATUS:
+	case MPU9250_FIFO_COUNTH:
+	case MPU9250_FIFO_COUNTL:
+	case MPU9250_FIFO_R_W:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* 읽으면 상태가 바뀜: regmap debugfs 덤프 등에서 읽지 않도록 */
+static bool my9250_precious_reg(struct device *dev, unsigned int reg)
+{
+	return reg == MPU9250_INT_STATUS || reg == MPU9250_FIFO_R_W ||
+	       reg == MPU9250_I2C_MST_STATUS;
+}
+
+/*
+ * 설정 레지스터는 캐시: 첫 접근 이후 설정 readback과 update_bits의 read는
+ * 버스를 타지 않음
+ */
+const struct regmap_config my9250_regmap_config = {
+	.reg_bits = 8,
+	.val_bits = 8,
+	.max_register = 0x7F,
+	.cache_type = REGCACHE_MAPLE,
+	.volatile_reg = my9250_volatile_reg,
+	.precious_reg = my9250_precious_reg,
+	.readable_noinc_reg = my9250_noinc_reg,
+};
+EXPORT_SYMBOL_NS_GPL(my9250_regmap_config, "MY9250");
+
+/* 데이터 경로 레지스터: 샘플 버스트, FIFO, INT_STATUS */
+static bool my9250_sample_reg(unsigned int reg)
+{
+	return reg == MPU9250_INT_STATUS || reg == MPU9250_FIFO_R_W ||
+	       reg == MPU9250_FIFO_COUNTH || reg == MPU9250_FIFO_COUNTL ||
+	       (reg >= MPU9250_ACCEL_XOUT_H && reg <= MPU9250_EXT_SENS_DATA_23);
+}
+
+void my9250_bus_account(struct my9250_bus_stats *bs, bool write,
+			unsigned int reg, size_t len, u64 t0, int ret)
+{
+	int kind = my9250_sample_reg(reg) ? MY9250_XFER_SAMPLE : MY9250_XFER_CONFIG;
+	u64 ns = ktime_get_ns() - t0;
+
+	atomic64_inc(&bs->xfers[kind]);
+	atomic64_add(len, &bs->bytes[kind]);
+	atomic64_add(ns, &bs->bus_ns[kind]);
+	if (ret) atomic64_inc(&bs->errors);
+	trace_my9250_xfer(bs->dev, write, reg, len, ns, ret);
+}
+EXPORT_SYMBOL_NS_GPL(my9250_bus_account, "MY9250");
+
+/*
+ * 데이터 블록 전체를 트랜잭션 한 번으로 읽음. 칩이 버스트 중에는 출력
+ * 레지스터를 갱신하지 않으므로 상/하위 바이트와 축들이 같은 샘플에서 옴
+ */
+static int my9250_read_burst(struct my9250_state *st, unsigned int reg,
+			     void *buf, size_t len)
+{
+	if (st->bus.read_burst)
+		return st->bus.read_burst(st->bus.ctx, reg, buf, len);
+	if (reg == MPU9250_FIFO_R_W)
+		return regmap_noinc_read(st->regmap, reg, buf, len);
+	return regmap_bulk_read(st->regmap, reg, buf, len);
+}
+
+/* 데이터 읽기 한 번 (n 샘플)의 IRQ/요청 -> 읽기 끝 지연 */
+static void my9250_sample_done(struct my9250_state *st, unsigned int n, s64 lat)
+{
+	struct my9250_bus_stats *bs = st->bus.stats;
+	u64 us = div_u64(max_t(s64, lat, 0), NSEC_PER_USEC);
+	unsigned int b;
+
+	b = us ? min_t(unsigned int, ilog2(us) + 1, MY9250_LAT_BUCKETS - 1) : 0;
+	atomic64_add(n, &bs->samples);
+	atomic64_inc(&bs->lat[b]);
+	trace_my9250_sample(st->dev, n, lat);
+}
+
+static int my9250_read_data(struct my9250_state *st, void *buf)
+{
+	return my9250_read_burst(st, MPU9250_ACCEL_XOUT_H, buf, st->data_len);
+}
+
+/* raw 16비트 읽기 헬퍼: chan->address는 데이터 블록 안의 첫 바이트 레지스터 */
+static int my9250_read16(struct my9250_state *st,
+			 struct iio_chan_spec const *chan, s16 *out)
+{
+	unsigned int off = chan->address - MPU9250_ACCEL_XOUT_H;
+	u64 now = ktime_get_ns();
+	int ret = 0;
+
+	mutex_lock(&st->lock);
+	if (!st->snap_valid || now - st->snap_ns >= NSEC_PER_SEC / st->odr_hz) {
+		ret = my9250_read_data(st, st->snap);
+		st->snap_valid = !ret;
+		st->snap_ns = now;
+		if (!ret) my9250_sample_done(st, 1, ktime_get_ns() - now);
+	}
+	if (!ret && chan->type == IIO_MAGN &&
+	    (st->snap[MPU9250_DATA_MAX - 1] & AK8963_ST2_HOFL))
+		ret = -ERANGE;  /* 자기장 포화: 값이 의미 없음 */
+	if (!ret)
+		*out = chan->scan_type.endianness == IIO_LE ?
+		       (s16)get_unaligned_le16(&st->snap[off]) :
+		       (s16)get_unaligned_be16(&st->snap[off]);
+	mutex_unlock(&st->lock);
+
+	return ret;
+}
+
+/* IIO 채널 = scan index: ACCEL_XOUT_H(0x3B)부터의 레지스터 순서 */
+enum {
+	CH_ACCEL_X, CH_ACCEL_Y, CH_ACCEL_Z,
+	CH_TEMP,
+	CH_GYRO_X, CH_GYRO_Y, CH_GYRO_Z,
+	CH_MAGN_X, CH_MAGN_Y, CH_MAGN_Z,
+	CH_TIMESTAMP,
+	CH_MAX
+};
+
+#define MY9250_SCAN_TYPE \
+	{ .sign = 's', .realbits = 16, .storagebits = 16, .endianness = IIO_BE }
+
+#define MY9250_CHAN(_type, _mod, _reg, _idx) {				\
+	.type = _type, .modified = 1, .channel2 = _mod,			\
+	.address = _reg,						\
+	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),			\
+	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |		\
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY),	\
+	.info_mask_shared_by_type_available = BIT(IIO_CHAN_INFO_SCALE) | \
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY),	\
+	.info_mask_shared_by_all = BIT(IIO_CHAN_INFO_SAMP_FREQ),	\
+	.info_mask_shared_by_all_available = BIT(IIO_CHAN_INFO_SAMP_FREQ), \
+	.scan_index = _idx,						\
+	.scan_type = MY9250_SCAN_TYPE,					\
+}
+
+/*
+ * AK8963 축은 칩 좌표 그대로 (MPU 기준으로는 x/y가 바뀌고 z가 반대).
+ * scale은 축마다 factory ASA를 반영해서 다름
+ */
+#define MY9250_MAGN_CHAN(_mod, _reg, _idx) {				\
+	.type = IIO_MAGN, .modified = 1, .channel2 = _mod,		\
+	.address = _reg,						\
+	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_SCALE), \
+	.info_mask_shared_by_all = BIT(IIO_CHAN_INFO_SAMP_FREQ),	\
+	.info_mask_shared_by_all_available = BIT(IIO_CHAN_INFO_SAMP_FREQ), \
+	.scan_index = _idx,						\
+	.scan_type = { .sign = 's', .realbits = 16, .storagebits = 16,	\
+		       .endianness = IIO_LE },				\
+}
+
+#define MY9250_IMU_CHANNELS						\
+	MY9250_CHAN(IIO_ACCEL, IIO_MOD_X, MPU9250_ACCEL_XOUT_H, CH_ACCEL_X),	\
+	MY9250_CHAN(IIO_ACCEL, IIO_MOD_Y, MPU9250_ACCEL_XOUT_H + 2, CH_ACCEL_Y),	\
+	MY9250_CHAN(IIO_ACCEL, IIO_MOD_Z, MPU9250_ACCEL_XOUT_H + 4, CH_ACCEL_Z),	\
+	{ .type = IIO_TEMP, .address = MPU9250_TEMP_OUT_H,		\
+	  .info_mask_separate = BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_SCALE) | \
+				BIT(IIO_CHAN_INFO_OFFSET),		\
+	  .info_mask_shared_by_all = BIT(IIO_CHAN_INFO_SAMP_FREQ),	\
+	  .info_mask_shared_by_all_available = BIT(IIO_CHAN_INFO_SAMP_FREQ), \
+	  .scan_index = CH_TEMP, .scan_type = MY9250_SCAN_TYPE },	\
+	MY9250_CHAN(IIO_ANGL_VEL, IIO_MOD_X, MPU9250_GYRO_XOUT_H, CH_GYRO_X),	\
+	MY9250_CHAN(IIO_ANGL_VEL, IIO_MOD_Y, MPU9250_GYRO_XOUT_H + 2, CH_GYRO_Y),	\
+	MY9250_CHAN(IIO_ANGL_VEL, IIO_MOD_Z, MPU9250_GYRO_XOUT_H + 4, CH_GYRO_Z)
+
+static const struct iio_chan_spec my9250_channels[] = {
+	MY9250_IMU_CHANNELS,
+	IIO_CHAN_SOFT_TIMESTAMP(CH_TIMESTAMP),
+};
+
+static const struct iio_chan_spec my9250_channels_9axis[] = {
+	MY9250_IMU_CHANNELS,
+	MY9250_MAGN_CHAN(IIO_MOD_X, MPU9250_EXT_SENS_DATA_00, CH_MAGN_X),
+	MY9250_MAGN_CHAN(IIO_MOD_Y, MPU9250_EXT_SENS_DATA_00 + 2, CH_MAGN_Y),
+	MY9250_MAGN_CHAN(IIO_MOD_Z, MPU9250_EXT_SENS_DATA_00 + 4, CH_MAGN_Z),
+	IIO_CHAN_SOFT_TIMESTAMP(CH_TIMESTAMP),
+};
+
+/* 버스트 한 번에 샘플 전부 읽으므로 부분 scan은 IIO demux에 맡김 */
+static const unsigned long my9250_scan_masks[] = {
+	GENMASK(CH_GYRO_Z, CH_ACCEL_X),
+	0
+};
+
+static const unsigned long my9250_scan_masks_9axis[] = {
+	GENMASK(CH_MAGN_Z, CH_ACCEL_X),
+	0
+};
+
+/* ODR = 1kHz / (1 + SMPLRT_DIV) 중 정수로 떨어지는 값 */
+static const int my9250_odr_avail[] = { 10, 20, 25, 40, 50, 100, 125, 200, 250, 500, 1000 };
+
+/*
+ * scale: FS_SEL 0..3 순서, IIO_VAL_INT_PLUS_NANO (val, val2) 쌍
+ * accel m/s^2 per LSB = 9.80665 / (16384 >> FS_SEL)
+ * gyro rad/s per LSB = (PI/180) / {131, 65.5, 32.8, 16.4}
+ */
+static const int my9250_accel_scale[] = {
+	0, 598550, 0, 1197101, 0, 2394202, 0, 4788403,
+};
+static const int my9250_gyro_scale[] = {
+	0, 133231, 0, 266462, 0, 532113, 0, 1064225,
+};
+
+/* 3dB 대역폭: DLPF_CFG / A_DLPF_CFG 1..6 순서, IIO_VAL_INT_PLUS_MICRO 쌍 */
+static const int my9250_gyro_bw[] = {
+	184, 0, 92, 0, 41, 0, 20, 0, 10, 0, 5, 0,
+};
+static const int my9250_accel_bw[] = {
+	218, 100000, 99, 0, 44, 800000, 21, 200000, 10, 200000, 5, 50000,
+};
+
+static int my9250_find_pair(const int *tbl, int n, int val, int val2)
+{
+	int i;
+
+	for (i = 0; i < n; i += 2)
+		if (tbl[i] == val && tbl[i + 1] == val2)
+			return i / 2;
+	return -EINVAL;
+}
+
+static int my9250_read_raw(struct iio_dev *indio_dev,
+			   struct iio_chan_spec const *chan,
+			   int *val, int *val2, long mask)
+{
+	struct my9250_state *st = iio_priv(indio_dev);
+	unsigned int reg;
+	s16 raw;
+	int ret;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_RAW:
+		/* 버퍼 동작 중에는 sysfs 읽기가 버스를 나눠 쓰지 않도록 막음 */
+		if (!iio_device_claim_direct(indio_dev))
+			return -EBUSY;
+		ret = my9250_read16(st, chan, &raw);
+		iio_device_release_direct(indio_dev);
+		if (ret) return ret;
+		*val = raw;
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_SCALE:
+		/* accel/gyro는 현재 full-scale 설정(캐시)에서 계산 */
+		if (chan->type == IIO_ACCEL || chan->type == IIO_ANGL_VEL) {
+			const int *tbl = chan->type == IIO_ACCEL ?
+					 my9250_accel_scale : my9250_gyro_scale;
+
+			ret = regmap_read(st->regmap, chan->type == IIO_ACCEL ?
+					  MPU9250_ACCEL_CONFIG : MPU9250_GYRO_CONFIG, &reg);
+			if (ret) return ret;
+			reg = FIELD_GET(MPU9250_FS_SEL_MASK, reg);
+			*val = tbl[reg * 2];
+			*val2 = tbl[reg * 2 + 1];
+			return IIO_VAL_INT_PLUS_NANO;
+		} else if (chan->type == IIO_MAGN) {
+			*val = 0;
+			*val2 = st->magn_scale[chan->scan_index - CH_MAGN_X];
+			return IIO_VAL_INT_PLUS_NANO;
+		} else if (chan->type == IIO_TEMP) {
+			/* milli-°C: 1 LSB = 1000/333.87 */
+			*val = 2;
+			*val2 = 995178;
+			return IIO_VAL_INT_PLUS_MICRO;
+		}
+		return -EINVAL;
+	case IIO_CHAN_INFO_OFFSET:
+		/* T = raw/333.87 + 21°C => offset = 21 * 333.87 LSB */
+		if (chan->type != IIO_TEMP)
+			return -EINVAL;
+		*val = 7011;
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		*val = st->odr_hz;
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY:
+		if (chan->type == IIO_ACCEL) {
+			ret = regmap_read(st->regmap, MPU9250_ACCEL_CONFIG2, &reg);
+			if (ret) return ret;
+			reg = clamp_val(reg & MPU9250_DLPF_CFG_MASK, 1, 6) - 1;
+			*val = my9250_accel_bw[reg * 2];
+			*val2 = my9250_accel_bw[reg * 2 + 1];
+		} else {
+			ret = regmap_read(st->regmap, MPU9250_CONFIG, &reg);
+			if (ret) return ret;
+			reg = clamp_val(reg & MPU9250_DLPF_CFG_MASK, 1, 6) - 1;
+			*val = my9250_gyro_bw[reg * 2];
+			*val2 = my9250_gyro_bw[reg * 2 + 1];
+		}
+		return IIO_VAL_INT_PLUS_MICRO;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int my9250_read_avail(struct iio_dev *indio_dev,
+			     struct iio_chan_spec const *chan,
+			     const int **vals, int *type, int *length, long mask)
+{
+	switch (mask) {
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		*vals = my9250_odr_avail;
+		*length = ARRAY_SIZE(my9250_odr_avail);
+		*type = IIO_VAL_INT;
+		return IIO_AVAIL_LIST;
+	case IIO_CHAN_INFO_SCALE:
+		*vals = chan->type == IIO_ACCEL ? my9250_accel_scale : my9250_gyro_scale;
+		*length = ARRAY_SIZE(my9250_accel_scale);
+		*type = IIO_VAL_INT_PLUS_NANO;
+		return IIO_AVAIL_LIST;
+	case IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY:
+		*vals = chan->type == IIO_ACCEL ? my9250_accel_bw : my9250_gyro_bw;
+		*length = ARRAY_SIZE(my9250_accel_bw);
+		*type = IIO_VAL_INT_PLUS_MICRO;
+		return IIO_AVAIL_LIST;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int my9250_mag_set_rate(struct my9250_state *st);
+
+static int my9250_write_config(struct my9250_state *st,
+			       struct iio_chan_spec const *chan,
+			       int val, int val2, long mask)
+{
+	int idx;
+
+	/* scale/LPF는 accel, gyro만 설정 가능 (temp, mag는 고정) */
+	if (mask != IIO_CHAN_INFO_SAMP_FREQ &&
+	    chan->type != IIO_ACCEL && chan->type != IIO_ANGL_VEL)
+		return -EINVAL;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		for (idx = 0; idx < ARRAY_SIZE(my9250_odr_avail); idx++)
+			if (my9250_odr_avail[idx] == val && !val2)
+				break;
+		if (idx == ARRAY_SIZE(my9250_odr_avail))
+			return -EINVAL;
+		idx = regmap_write(st->regmap, MPU9250_SMPLRT_DIV,
+				   MPU9250_INTERNAL_HZ / val - 1);
+		if (idx) return idx;
+		st->odr_hz = val;
+		st->snap_valid = false;
+		return st->has_mag ? my9250_mag_set_rate(st) : 0;
+	case IIO_CHAN_INFO_SCALE:
+		if (chan->type == IIO_ACCEL) {
+			idx = my9250_find_pair(my9250_accel_scale,
+					       ARRAY_SIZE(my9250_accel_scale), val, val2);
+			if (idx < 0) return idx;
+			return regmap_update_bits(st->regmap, MPU9250_ACCEL_CONFIG,
+						  MPU9250_FS_SEL_MASK,
+						  FIELD_PREP(MPU9250_FS_SEL_MASK, idx));
+		}
+		idx = my9250_find_pair(my9250_gyro_scale,
+				       ARRAY_SIZE(my9250_gyro_scale), val, val2);
+		if (idx < 0) return idx;
+		return regmap_update_bits(st->regmap, MPU9250_GYRO_CONFIG,
+					  MPU9250_FS_SEL_MASK,
+					  FIELD_PREP(MPU9250_FS_SEL_MASK, idx));
+	case IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY:
+		if (chan->type == IIO_ACCEL) {
+			idx = my9250_find_pair(my9250_accel_bw,
+					       ARRAY_SIZE(my9250_accel_bw), val, val2);
+			if (idx < 0) return idx;
+			/* FCHOICE_B = 0: DLPF 사용, 내부 1kHz */
+			return regmap_update_bits(st->regmap, MPU9250_ACCEL_CONFIG2,
+						  MPU9250_A_DLPF_MASK, idx + 1);
+		}
+		idx = my9250_find_pair(my9250_gyro_bw,
+				       ARRAY_SIZE(my9250_gyro_bw), val, val2);
+		if (idx < 0) return idx;
+		return regmap_update_bits(st->regmap, MPU9250_CONFIG,
+					  MPU9250_DLPF_CFG_MASK, idx + 1);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int my9250_write_raw(struct iio_dev *indio_dev,
+			    struct iio_chan_spec const *chan,
+			    int val, int val2, long mask)
+{
+	struct my9250_state *st = iio_priv(indio_dev);
+	int ret;
+
+	/* ODR/FS가 바뀌면 버퍼의 timestamp 간격과 샘플 의미가 달라지므로 막음 */
+	if (!iio_device_claim_direct(indio_dev))
+		return -EBUSY;
+	mutex_lock(&st->lock);
+	/* 자세 필터도 같은 샘플을 쓰므로 그쪽 버퍼가 켜져 있을 때도 막음 */
+	if (iio_buffer_enabled(st->orient))
+		ret = -EBUSY;
+	else
+		ret = my9250_write_config(st, chan, val, val2, mask);
+	mutex_unlock(&st->lock);
+	iio_device_release_direct(indio_dev);
+
+	return ret;
+}
+
+static int my9250_write_raw_get_fmt(struct iio_dev *indio_dev,
+				    struct iio_chan_spec const *chan, long mask)
+{
+	switch (mask) {
+	case IIO_CHAN_INFO_SCALE:
+		return IIO_VAL_INT_PLUS_NANO;
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		return IIO_VAL_INT;
+	default:
+		return IIO_VAL_INT_PLUS_MICRO;
+	}
+}
+
+static int my9250_fifo_reset(struct my9250_state *st)
+{
+	return regmap_update_bits(st->regmap, MPU9250_USER_CTRL,
+				  MPU9250_USER_FIFO_RST, MPU9250_USER_FIFO_RST);
+}
+
+static int my9250_fifo_enable(struct my9250_state *st, bool on)
+{
+	int ret;
+
+	ret = regmap_write(st->regmap, MPU9250_FIFO_EN, 0);
+	if (ret) return ret;
+	ret = regmap_update_bits(st->regmap, MPU9250_USER_CTRL,
+				 MPU9250_USER_FIFO_EN, 0);
+	if (ret) return ret;
+	ret = my9250_fifo_reset(st);
+	if (ret || !on) return ret;
+
+	ret = regmap_update_bits(st->regmap, MPU9250_USER_CTRL,
+				 MPU9250_USER_FIFO_EN, MPU9250_USER_FIFO_EN);
+	if (ret) return ret;
+	return regmap_write(st->regmap, MPU9250_FIFO_EN, MPU9250_FIFO_EN_DATA |
+			    (st->has_mag ? MPU9250_FIFO_EN_SLV0 : 0));
+}
+
+/* gyro LSB당 rad/s (Q30): 현재 full-scale(캐시)에서 */
+static s64 my9250_gyro_k(struct my9250_state *st)
+{
+	unsigned int reg;
+
+	if (regmap_read(st->regmap, MPU9250_GYRO_CONFIG, &reg))
+		reg = 0;
+	reg = FIELD_GET(MPU9250_FS_SEL_MASK, reg);
+	return div_s64((s64)my9250_gyro_scale[reg * 2 + 1] << MY9250_Q30_SHIFT,
+		       NSEC_PER_SEC);
+}
+
+/* st->scan의 accel/gyro로 필터 한 스텝, decim 샘플마다 quaternion push */
+static void my9250_fusion_sample(struct my9250_state *st, s64 ts)
+{
+	s16 acc[3], gyr[3];
+	u32 dt_ns;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		acc[i] = be16_to_cpu(st->scan.chans[CH_ACCEL_X + i]);
+		gyr[i] = be16_to_cpu(st->scan.chans[CH_GYRO_X + i]);
+	}
+	dt_ns = st->fusion_ts ? clamp_t(s64, ts - st->fusion_ts, 0, U32_MAX) :
+		NSEC_PER_SEC / st->odr_hz;
+	st->fusion_ts = ts;
+	my9250_fusion_update(&st->fusion, acc, gyr, my9250_gyro_k(st), dt_ns);
+
+	if (++st->fusion_cnt < st->fusion_decim)
+		return;
+	st->fusion_cnt = 0;
+	memcpy(st->qscan.q, st->fusion.q, sizeof(st->qscan.q));
+	iio_push_to_buffers_with_ts(st->orient, &st->qscan, sizeof(st->qscan), ts);
+}
+
+/*
+ * st->scan에 읽어 둔 샘플 하나를 켜져 있는 버퍼들로. fuse는 자체 trigger
+ * 샘플이라는 뜻: 메인 버퍼가 다른 trigger에 붙어 있으면 거기엔 안 넣음
+ */
+static void my9250_process_sample(struct my9250_state *st, s64 ts, bool fuse)
+{
+	if (iio_buffer_enabled(st->indio) &&
+	    (!fuse || st->indio->trig == st->trig))
+		iio_push_to_buffers_with_ts(st->indio, &st->scan, sizeof(st->scan), ts);
+	if (fuse && iio_buffer_enabled(st->orient))
+		my9250_fusion_sample(st, ts);
+}
+
+/*
+ * FIFO에 쌓인 샘플을 한 번의 긴 버스트로 비움. timestamp는 직전 drain과
+ * 이번 drain(now) 사이를 샘플 수로 나눠 보간. 호출자가 st->lock 보유
+ */
+static int my9250_fifo_drain(struct my9250_state *st, s64 now, bool fuse)
+{
+	struct device *dev = st->dev;
+	unsigned int status;
+	__be16 count_be;
+	size_t count, n, i;
+	s64 step;
+	int ret;
+
+	ret = regmap_read(st->regmap, MPU9250_INT_STATUS, &status);
+	if (ret) return ret;
+	ret = regmap_bulk_read(st->regmap, MPU9250_FIFO_COUNTH, &count_be, 2);
+	if (ret) return ret;
+	count = be16_to_cpu(count_be) & 0x1FFF;
+
+	/* 가득 차면 샘플 경계가 깨질 수 있으므로 버리고 다시 시작 */
+	if ((status & MPU9250_INT_FIFO_OFLOW) ||
+	    count > MPU9250_FIFO_SIZE - st->data_len) {
+		dev_warn_ratelimited(dev, "fifo overflow (%zu bytes), reset\n", count);
+		atomic64_inc(&st->bus.stats->fifo_resets);
+		st->fifo_ts = now;
+		return my9250_fifo_reset(st);
+	}
+
+	n = min_t(size_t, count / st->data_len,
+		  sizeof(st->fifo_buf) / st->data_len);
+	if (!n) return 0;
+
+	ret = my9250_read_burst(st, MPU9250_FIFO_R_W, st->fifo_buf,
+				n * st->data_len);
+	if (ret) return ret;
+	my9250_sample_done(st, n, iio_get_time_ns(st->indio) - now);
+
+	step = div_s64(now - st->fifo_ts, n);
+	for (i = 0; i < n; i++) {
+		memcpy(&st->scan, st->fifo_buf + i * st->data_len, st->data_len);
+		my9250_process_sample(st, st->fifo_ts + step * (s64)(i + 1), fuse);
+	}
+	st->fifo_ts = now;
+
+	return n;
+}
+
+/* 샘플 하나 = 버스트 읽기 한 번, FIFO 모드면 batch */
+static void my9250_sample_event(struct my9250_state *st, s64 ts, bool fuse)
+{
+	mutex_lock(&st->lock);
+	if (st->fifo_on)
+		my9250_fifo_drain(st, ts, fuse);
+	else if (!my9250_read_data(st, &st->scan)) {
+		my9250_sample_done(st, 1, iio_get_time_ns(st->indio) - ts);
+		my9250_process_sample(st, ts, fuse);
+	}
+	mutex_unlock(&st->lock);
+}
+
+/*
+ * trigger bottom half. 자체 trigger에 붙어 있으면 자세 필터에도 샘플을
+ * 넘김 (다른 trigger면 샘플 간격이 ODR과 무관하므로 제외)
+ */
+static irqreturn_t my9250_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio = pf->indio_dev;
+	struct my9250_state *st = iio_priv(indio);
+
+	my9250_sample_event(st, pf->timestamp, indio->trig == st->trig);
+
+	iio_trigger_notify_done(indio->trig);
+	return IRQ_HANDLED;
+}
+
+/* 메인 버퍼가 같은 trigger로 돌고 있으면 그쪽 handler가 필터까지 처리 */
+static irqreturn_t my9250_orient_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *orient = pf->indio_dev;
+	struct my9250_state *st = *(struct my9250_state **)iio_priv(orient);
+
+	if (!iio_buffer_enabled(st->indio) || st->indio->trig != st->trig)
+		my9250_sample_event(st, pf->timestamp, true);
+
+	iio_trigger_notify_done(orient->trig);
+	return IRQ_HANDLED;
+}
+
+/* ODR(또는 FIFO 모드의 watermark) 주기로 trigger를 발생 (hardirq 컨텍스트) */
+static enum hrtimer_restart my9250_timer_fn(struct hrtimer *timer)
+{
+	struct my9250_state *st = container_of(timer, struct my9250_state, timer);
+
+	hrtimer_forward_now(timer, st->period);
+	iio_trigger_poll(st->trig);
+	return HRTIMER_RESTART;
+}
+
+static int my9250_trigger_set_state(struct iio_trigger *trig, bool state)
+{
+	struct my9250_state *st = iio_trigger_get_drvdata(trig);
+	struct iio_dev *indio = st->indio;
+	bool use_timer;
+	int ret;
+
+	if (!state) {
+		hrtimer_cancel(&st->timer);
+		ret = regmap_write(st->regmap, MPU9250_INT_ENABLE, 0);
+		if (st->fifo_on) {
+			mutex_lock(&st->lock);
+			/* 남은 샘플까지 내보내고 끔 */
+			my9250_fifo_drain(st, iio_get_time_ns(indio), true);
+			st->fifo_on = false;
+			mutex_unlock(&st->lock);
+			ret = my9250_fifo_enable(st, false) ?: ret;
+		}
+		return ret;
+	}
+
+	st->fifo_on = st->watermark > 1;
+	if (st->fifo_on) {
+		ret = my9250_fifo_enable(st, true);
+		if (ret) {
+			st->fifo_on = false;
+			return ret;
+		}
+		st->fifo_ts = iio_get_time_ns(indio);
+		st->period = ns_to_ktime((u64)NSEC_PER_SEC * st->watermark / st->odr_hz);
+		use_timer = true;
+		ret = regmap_write(st->regmap, MPU9250_INT_ENABLE, 0);
+	} else {
+		st->period = ns_to_ktime(NSEC_PER_SEC / st->odr_hz);
+		use_timer = st->bus.irq <= 0;
+		ret = regmap_write(st->regmap, MPU9250_INT_ENABLE,
+				   use_timer ? 0 : MPU9250_INT_RAW_RDY_EN);
+	}
+	if (ret) return ret;
+
+	if (use_timer)
+		hrtimer_start(&st->timer, st->period, HRTIMER_MODE_REL_HARD);
+	return 0;
+}
+
+static const struct iio_trigger_ops my9250_trigger_ops = {
+	.set_trigger_state = my9250_trigger_set_state,
+};
+
+static int my9250_set_watermark(struct iio_dev *indio, unsigned int val)
+{
+	struct my9250_state *st = iio_priv(indio);
+
+	/* 버퍼를 켤 때 IIO core가 buffer/watermark 값으로 호출 */
+	st->watermark = clamp_val(val, 1, st->watermark_max);
+	return 0;
+}
+
+static int my9250_flush(struct iio_dev *indio, unsigned int count)
+{
+	struct my9250_state *st = iio_priv(indio);
+	int ret;
+
+	mutex_lock(&st->lock);
+	ret = st->fifo_on ? my9250_fifo_drain(st, iio_get_time_ns(indio),
+					      indio->trig == st->trig) : 0;
+	mutex_unlock(&st->lock);
+
+	return ret;
+}
+
+static ssize_t hwfifo_watermark_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct my9250_state *st = iio_priv(dev_to_iio_dev(dev));
+
+	return sysfs_emit(buf, "%u\n", st->watermark);
+}
+
+static ssize_t hwfifo_enabled_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct my9250_state *st = iio_priv(dev_to_iio_dev(dev));
+
+	return sysfs_emit(buf, "%d\n", st->fifo_on);
+}
+
+static ssize_t hwfifo_watermark_max_show(struct device *dev,
+					 struct device_attribute *attr, char *buf)
+{
+	struct my9250_state *st = iio_priv(dev_to_iio_dev(dev));
+
+	return sysfs_emit(buf, "%u\n", st->watermark_max);
+}
+
+static IIO_STATIC_CONST_DEVICE_ATTR(hwfifo_watermark_min, "1");
+static IIO_DEVICE_ATTR_RO(hwfifo_watermark_max, 0);
+static IIO_DEVICE_ATTR_RO(hwfifo_watermark, 0);
+static IIO_DEVICE_ATTR_RO(hwfifo_enabled, 0);
+
+static const struct iio_dev_attr *my9250_fifo_attrs[] = {
+	&iio_dev_attr_hwfifo_watermark_min,
+	&iio_dev_attr_hwfifo_watermark_max,
+	&iio_dev_attr_hwfifo_watermark,
+	&iio_dev_attr_hwfifo_enabled,
+	NULL
+};
+
+static const struct iio_info my9250_iio_info = {
+	.read_raw = my9250_read_raw,
+	.read_avail = my9250_read_avail,
+	.write_raw = my9250_write_raw,
+	.write_raw_get_fmt = my9250_write_raw_get_fmt,
+	.hwfifo_set_watermark = my9250_set_watermark,
+	.hwfifo_flush_to_buffer = my9250_flush,
+};
+
+/*
+ * 자세 출력: quaternion (w, x, y, z), 단위 quaternion을 2^30배한 s32.
+ * 기준 좌표계는 필터를 리셋한 (버퍼를 켠) 순간의 센서 자세, yaw는 mag 없이
+ * gyro 적분이라 천천히 흐름. sampling_frequency = ODR / decimation
+ */
+static const struct iio_chan_spec my9250_orient_channels[] = {
+	{
+		.type = IIO_ROT,
+		.modified = 1,
+		.channel2 = IIO_MOD_QUATERNION,
+		.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),
+		.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE),
+		.info_mask_shared_by_all = BIT(IIO_CHAN_INFO_SAMP_FREQ),
+		.scan_index = 0,
+		.scan_type = {
+			.sign = 's',
+			.realbits = 32,
+			.storagebits = 32,
+			.repeat = 4,
+			.endianness = IIO_CPU,
+		},
+	},
+	IIO_CHAN_SOFT_TIMESTAMP(1),
+};
+
+static int my9250_orient_read_raw(struct iio_dev *orient,
+				  struct iio_chan_spec const *chan,
+				  int size, int *vals, int *val_len, long mask)
+{
+	struct my9250_state *st = *(struct my9250_state **)iio_priv(orient);
+	int i;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_RAW:
+		/* 버퍼가 켜져 있을 때만 필터가 돌므로 그 외에는 값이 없음 */
+		if (size < 4 || !iio_buffer_enabled(orient))
+			return -EBUSY;
+		mutex_lock(&st->lock);
+		for (i = 0; i < 4; i++)
+			vals[i] = st->fusion.q[i];
+		mutex_unlock(&st->lock);
+		*val_len = 4;
+		return IIO_VAL_INT_MULTIPLE;
+	case IIO_CHAN_INFO_SCALE:
+		vals[0] = 1;
+		vals[1] = MY9250_Q30_SHIFT;
+		*val_len = 2;
+		return IIO_VAL_FRACTIONAL_LOG2;
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		vals[0] = st->odr_hz;
+		vals[1] = st->fusion_decim;
+		*val_len = 2;
+		return IIO_VAL_FRACTIONAL;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int my9250_orient_write_raw(struct iio_dev *orient,
+				   struct iio_chan_spec const *chan,
+				   int val, int val2, long mask)
+{
+	struct my9250_state *st = *(struct my9250_state **)iio_priv(orient);
+
+	if (mask != IIO_CHAN_INFO_SAMP_FREQ)
+		return -EINVAL;
+	if (val <= 0 || val > st->odr_hz)
+		return -EINVAL;
+
+	if (!iio_device_claim_direct(orient))
+		return -EBUSY;
+	mutex_lock(&st->lock);
+	st->fusion_decim = DIV_ROUND_CLOSEST(st->odr_hz, val);
+	mutex_unlock(&st->lock);
+	iio_device_release_direct(orient);
+
+	return 0;
+}
+
+static int my9250_orient_write_raw_get_fmt(struct iio_dev *orient,
+					   struct iio_chan_spec const *chan,
+					   long mask)
+{
+	return IIO_VAL_INT;
+}
+
+/* 버퍼를 켤 때마다 필터를 단위 quaternion에서 다시 시작 */
+static int my9250_orient_preenable(struct iio_dev *orient)
+{
+	struct my9250_state *st = *(struct my9250_state **)iio_priv(orient);
+
+	mutex_lock(&st->lock);
+	my9250_fusion_reset(&st->fusion, MY9250_FUSION_KP, MY9250_FUSION_KI);
+	st->fusion_cnt = 0;
+	st->fusion_ts = 0;
+	mutex_unlock(&st->lock);
+
+	return 0;
+}
+
+static const struct iio_buffer_setup_ops my9250_orient_buffer_ops = {
+	.preenable = my9250_orient_preenable,
+};
+
+/* 샘플 간격이 ODR이어야 하므로 자체 trigger만 */
+static const struct iio_info my9250_orient_info = {
+	.read_raw_multi = my9250_orient_read_raw,
+	.write_raw = my9250_orient_write_raw,
+	.write_raw_get_fmt = my9250_orient_write_raw_get_fmt,
+	.validate_trigger = iio_validate_own_trigger,
+};
+
+static int my9250_orient_init(struct my9250_state *st)
+{
+	struct device *dev = st->dev;
+	struct iio_dev *orient;
+
+	orient = devm_iio_device_alloc(dev, sizeof(st));
+	if (!orient) return -ENOMEM;
+	*(struct my9250_state **)iio_priv(orient) = st;
+
+	orient->name = "my-mpu9250-orientation";
+	orient->modes = INDIO_DIRECT_MODE;
+	orient->info = &my9250_orient_info;
+	orient->channels = my9250_orient_channels;
+	orient->num_channels = ARRAY_SIZE(my9250_orient_channels);
+	orient->trig = iio_trigger_get(st->trig);
+	st->orient = orient;
+	st->fusion_decim = 1;
+	my9250_fusion_reset(&st->fusion, MY9250_FUSION_KP, MY9250_FUSION_KI);
+
+	return devm_iio_triggered_buffer_setup(dev, orient,
+					       iio_pollfunc_store_time,
+					       my9250_orient_trigger_handler,
+					       &my9250_orient_buffer_ops);
+}
+
+static int my9250_trigger_init(struct iio_dev *indio)
+{
+	struct my9250_state *st = iio_priv(indio);
+	struct device *dev = st->dev;
+	int irq = st->bus.irq;
+	int ret;
+
+	st->trig = devm_iio_trigger_alloc(dev, "%s-dev%d", indio->name,
+					  iio_device_id(indio));
+	if (!st->trig) return -ENOMEM;
+	iio_trigger_set_drvdata(st->trig, st);
+	st->trig->ops = &my9250_trigger_ops;
+	st->watermark = 1;
+
+	/* IRQ 유무와 관계없이 FIFO 모드의 drain 주기로도 사용 */
+	hrtimer_setup(&st->timer, my9250_timer_fn, CLOCK_MONOTONIC,
+		      HRTIMER_MODE_REL_HARD);
+
+	if (irq > 0) {
+		/* DRDY는 샘플마다 50us 펄스: 트리거 타입은 DT, 없으면 rising */
+		ret = devm_request_irq(dev, irq, iio_trigger_generic_data_rdy_poll,
+				       irq_get_trigger_type(irq) ?: IRQF_TRIGGER_RISING,
+				       indio->name, st->trig);
+		if (ret) return ret;
+	} else {
+		dev_info(dev, "no DRDY irq, using %d Hz hrtimer trigger\n",
+			 st->odr_hz);
+	}
+
+	ret = devm_iio_trigger_register(dev, st->trig);
+	if (ret) return ret;
+
+	indio->trig = iio_trigger_get(st->trig);
+	return 0;
+}
+
+/*
+ * SLV4로 AK8963 레지스터 하나를 읽거나 씀 (초기화용). 보조 버스 트랜잭션은
+ * 샘플 주기에 맞춰 돌므로 최대 수 ms 걸림
+ */
+static int my9250_aux_xfer(struct my9250_state *st, u8 reg, u8 *val, bool read)
+{
+	unsigned int status, di;
+	int ret;
+
+	ret = regmap_write(st->regmap, MPU9250_I2C_SLV4_ADDR,
+			   AK8963_ADDR | (read ? MPU9250_I2C_SLV_READ : 0));
+	if (ret) return ret;
+	ret = regmap_write(st->regmap, MPU9250_I2C_SLV4_REG, reg);
+	if (ret) return ret;
+	if (!read) {
+		ret = regmap_write(st->regmap, MPU9250_I2C_SLV4_DO, *val);
+		if (ret) return ret;
+	}
+	ret = regmap_write(st->regmap, MPU9250_I2C_SLV4_CTRL,
+			   MPU9250_I2C_SLV_EN | st->mag_dly);
+	if (ret) return ret;
+
+	ret = regmap_read_poll_timeout(st->regmap, MPU9250_I2C_MST_STATUS, status,
+				       status & MPU9250_I2C_SLV4_DONE, 1000, 50000);
+	if (ret) return ret;
+	if (status & MPU9250_I2C_SLV4_NACK)
+		return -EIO;
+
+	if (read) {
+		ret = regmap_read(st->regmap, MPU9250_I2C_SLV4_DI, &di);
+		if (ret) return ret;
+		*val = di;
+	}
+	return 0;
+}
+
+static int my9250_aux_write(struct my9250_state *st, u8 reg, u8 val)
+{
+	int ret = my9250_aux_xfer(st, reg, &val, false);
+
+	usleep_range(1000, 2000);  /* AK8963 모드 전환 대기 (>100us) */
+	return ret;
+}
+
+/* mag는 100Hz라 ODR이 높으면 SLV0 읽기를 (1 + dly) 샘플마다 한 번으로 */
+static int my9250_mag_set_rate(struct my9250_state *st)
+{
+	st->mag_dly = clamp(st->odr_hz / AK8963_ODR_HZ - 1, 0, 31);
+
+	return regmap_write(st->regmap, MPU9250_I2C_SLV4_CTRL, st->mag_dly);
+}
+
+/*
+ * MPU9250의 I2C master가 샘플마다 AK8963 HXL..ST2를 EXT_SENS_DATA_00에
+ * 읽어 두도록 설정. bypass 모드와 달리 host 버스 트랜잭션이 늘지 않음.
+ * AK8963이 응답하지 않으면 -ENODEV (6축으로 동작)
+ */
+static int my9250_mag_init(struct my9250_state *st)
+{
+	u8 wia, asa[3];
+	int ret, i;
+
+	ret = regmap_update_bits(st->regmap, MPU9250_USER_CTRL,
+				 MPU9250_USER_I2C_MST_EN, MPU9250_USER_I2C_MST_EN);
+	if (ret) return ret;
+	ret = regmap_write(st->regmap, MPU9250_I2C_MST_CTRL,
+			   MPU9250_I2C_MST_WAIT_ES | MPU9250_I2C_MST_400KHZ);
+	if (ret) return ret;
+
+	ret = my9250_aux_xfer(st, AK8963_WIA, &wia, true);
+	if (ret || wia != AK8963_WIA_VAL)
+		goto no_mag;
+
+	/* fuse ROM에서 감도 보정값: H_adj = H * (ASA + 128) / 256 */
+	ret = my9250_aux_write(st, AK8963_CNTL1, AK8963_MODE_POWER_DOWN);
+	if (ret) goto no_mag;
+	ret = my9250_aux_write(st, AK8963_CNTL1, AK8963_BIT_16 | AK8963_MODE_FUSE_ROM);
+	if (ret) goto no_mag;
+	for (i = 0; i < 3; i++) {
+		ret = my9250_aux_xfer(st, AK8963_ASAX + i, &asa[i], true);
+		if (ret) goto no_mag;
+		st->magn_scale[i] = AK8963_SCALE_NGAUSS * (asa[i] + 128) / 256;
+	}
+	ret = my9250_aux_write(st, AK8963_CNTL1, AK8963_MODE_POWER_DOWN);
+	if (ret) goto no_mag;
+	ret = my9250_aux_write(st, AK8963_CNTL1, AK8963_BIT_16 | AK8963_MODE_CONT_100HZ);
+	if (ret) goto no_mag;
+
+	/* SLV0: HXL부터 7바이트 (ST2까지 읽어야 다음 측정값이 래치됨) */
+	ret = regmap_write(st->regmap, MPU9250_I2C_SLV0_ADDR,
+			   AK8963_ADDR | MPU9250_I2C_SLV_READ);
+	if (ret) return ret;
+	ret = regmap_write(st->regmap, MPU9250_I2C_SLV0_REG, AK8963_HXL);
+	if (ret) return ret;
+	ret = regmap_write(st->regmap, MPU9250_I2C_SLV0_CTRL,
+			   MPU9250_I2C_SLV_EN | MPU9250_MAG_LEN);
+	if (ret) return ret;
+	ret = regmap_write(st->regmap, MPU9250_I2C_MST_DELAY_CTRL,
+			   MPU9250_I2C_DELAY_ES_SHADOW | MPU9250_I2C_SLV0_DLY_EN);
+	if (ret) return ret;
+
+	dev_info(st->dev, "AK8963 ASA %u/%u/%u\n", asa[0], asa[1], asa[2]);
+	return my9250_mag_set_rate(st);
+
+no_mag:
+	dev_info(st->dev, "no AK8963 (%d), 6-axis only\n", ret);
+	regmap_update_bits(st->regmap, MPU9250_USER_CTRL, MPU9250_USER_I2C_MST_EN, 0);
+	return -ENODEV;
+}
+
+static int my9250_chip_init(struct my9250_state *st)
+{
+	int val, ret;
+
+	/* WHO_AM_I 확인 */
+	ret = regmap_read(st->regmap, MPU9250_WHO_AM_I, &val);
+	if (ret) return ret;
+	if (val != MPU9250_WHO_AM_I_VAL)
+		return -ENODEV;
+
+	/* 슬립 해제, 내부 클럭 사용 */
+	ret = regmap_write(st->regmap, MPU9250_PWR_MGMT_1, 0x00);
+	if (ret) return ret;
+
+	if (st->bus.is_spi) {
+		ret = regmap_update_bits(st->regmap, MPU9250_USER_CTRL,
+					 MPU9250_USER_I2C_IF_DIS,
+					 MPU9250_USER_I2C_IF_DIS);
+		if (ret) return ret;
+	}
+
+	/* 최소 초기화: LPF 기본값, 샘플분주, 풀스케일 기본 */
+	regmap_write(st->regmap, MPU9250_SMPLRT_DIV, MPU9250_SMPLRT_DIV_VAL); /* 1kHz */
+	regmap_write(st->regmap, MPU9250_CONFIG,
+		     MPU9250_CONFIG_FIFO_MODE | MPU9250_DLPF_DEFAULT);  /* DLPF */
+	regmap_write(st->regmap, MPU9250_ACCEL_CONFIG2, MPU9250_DLPF_DEFAULT);
+	regmap_write(st->regmap, MPU9250_GYRO_CONFIG, 0x00);  /* ±250dps */
+	regmap_write(st->regmap, MPU9250_ACCEL_CONFIG, 0x00); /* ±2g */
+	st->odr_hz = MPU9250_INTERNAL_HZ / (1 + MPU9250_SMPLRT_DIV_VAL);
+
+	/* INT: active-high push-pull 50us 펄스, 버퍼 켤 때까지 DRDY 끔 */
+	regmap_write(st->regmap, MPU9250_INT_PIN_CFG, 0x00);
+	regmap_write(st->regmap, MPU9250_INT_ENABLE, 0x00);
+
+	ret = my9250_mag_init(st);
+	if (ret && ret != -ENODEV) return ret;
+	st->has_mag = !ret;
+	st->data_len = st->has_mag ? MPU9250_DATA_MAX : MPU9250_DATA_LEN;
+	st->watermark_max = MPU9250_FIFO_SIZE / st->data_len - MPU9250_FIFO_WM_SLACK;
+
+	return 0;
+}
+
+static int my9250_stats_show(struct seq_file *m, void *v)
+{
+	static const char * const kind[] = { "config", "sample" };
+	struct my9250_state *st = m->private;
+	struct my9250_bus_stats *bs = st->bus.stats;
+	u64 samples = atomic64_read(&bs->samples);
+	unsigned int i;
+
+	seq_printf(m, "bus:        %s, odr %d Hz, watermark %u%s\n",
+		   st->bus.is_spi ? "spi" : "i2c", st->odr_hz, st->watermark,
+		   st->fifo_on ? " (fifo)" : "");
+	for (i = 0; i < MY9250_XFER_NUM; i++)
+		seq_printf(m, "%-7s     %llu xfers, %llu bytes (reg+data), %llu us\n", kind[i],
+			   (u64)atomic64_read(&bs->xfers[i]), (u64)atomic64_read(&bs->bytes[i]),
+			   div_u64(atomic64_read(&bs->bus_ns[i]), NSEC_PER_USEC));
+	seq_printf(m, "errors:     %llu\n", (u64)atomic64_read(&bs->errors));
+	seq_printf(m, "fifo_resets: %llu\n", (u64)atomic64_read(&bs->fifo_resets));
+	seq_printf(m, "samples:    %llu\n", samples);
+	if (samples)
+		seq_printf(m, "per sample: %llu bytes (reg+data), %llu ns bus\n",
+			   div64_u64(atomic64_read(&bs->bytes[MY9250_XFER_SAMPLE]), samples),
+			   div64_u64(atomic64_read(&bs->bus_ns[MY9250_XFER_SAMPLE]), samples));
+
+	seq_puts(m, "read latency (IRQ/request -> data read):\n");
+	for (i = 0; i < MY9250_LAT_BUCKETS; i++) {
+		u64 cnt = atomic64_read(&bs->lat[i]);
+
+		if (i == 0)
+			seq_printf(m, "  %10s %llu\n", "<1us", cnt);
+		else if (i == MY9250_LAT_BUCKETS - 1)
+			seq_printf(m, "  >=%7uus %llu\n", 1U << (i - 1), cnt);
+		else
+			seq_printf(m, "  <%8uus %llu\n", 1U << i, cnt);
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(my9250_stats);
+
+static void my9250_debugfs_remove(void *arg)
+{
+	debugfs_remove_recursive(arg);
+}
+
+static int my9250_debugfs_init(struct my9250_state *st)
+{
+	struct dentry *dir;
+	char name[32];
+
+	snprintf(name, sizeof(name), "my9250-%s", dev_name(st->dev));
+	dir = debugfs_create_dir(name, NULL);
+	debugfs_create_file("stats", 0444, dir, st, &my9250_stats_fops);
+	return devm_add_action_or_reset(st->dev, my9250_debugfs_remove, dir);
+}
+
+int my9250_core_probe(struct device *dev, const struct my9250_bus *bus)
+{
+	struct iio_dev *indio;
+	struct my9250_state *st;
+	int ret;
+
+	indio = devm_iio_device_alloc(dev, sizeof(*st));
+	if (!indio) return -ENOMEM;
+
+	st = iio_priv(indio);
+	st->dev = dev;
+	st->bus = *bus;
+	st->regmap = bus->regmap;
+	st->indio = indio;
+	mutex_init(&st->lock);
+
+	ret = my9250_chip_init(st);
+	if (ret) return ret;
+
+	indio->name = "my-mpu9250";
+	indio->modes = INDIO_DIRECT_MODE;
+	indio->info  = &my9250_iio_info;
+	if (st->has_mag) {
+		indio->channels = my9250_channels_9axis;
+		indio->num_channels = ARRAY_SIZE(my9250_channels_9axis);
+		indio->available_scan_masks = my9250_scan_masks_9axis;
+	} else {
+		indio->channels = my9250_channels;
+		indio->num_channels = ARRAY_SIZE(my9250_channels);
+		indio->available_scan_masks = my9250_scan_masks;
+	}
+
+	ret = my9250_trigger_init(indio);
+	if (ret) return ret;
+
+	ret = my9250_orient_init(st);
+	if (ret) return ret;
+
+	/* top half(iio_pollfunc_store_time)가 IRQ 시점 timestamp를 기록 */
+	ret = devm_iio_triggered_buffer_setup_ext(dev, indio,
+						  iio_pollfunc_store_time,
+						  my9250_trigger_handler,
+						  IIO_BUFFER_DIRECTION_IN, NULL,
+						  my9250_fifo_attrs);
+	if (ret) return ret;
+
+	ret = devm_iio_device_register(dev, indio);
+	if (ret) return ret;
+
+	ret = devm_iio_device_register(dev, st->orient);
+	if (ret) return ret;
+
+	ret = my9250_debugfs_init(st);
+	if (ret) return ret;
+
+	dev_info(dev, "my-mpu9250 ready (%s)\n", bus->is_spi ? "spi" : "i2c");
+	return 0;
+}
+EXPORT_SYMBOL_NS_GPL(my9250_core_probe, "MY9250");
+
+MODULE_AUTHOR("you");
+MODULE_DESCRIPTION("Minimal MPU9250 IIO driver example - core");
+MODULE_LICENSE("GPL");
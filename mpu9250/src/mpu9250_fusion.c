@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * my-mpu9250 Mahony 필터 (정수 연산). 범위:
+ *  - q, 단위벡터: |x| <= 1 -> Q30 (s32), 곱은 s64에서 >> 30
+ *  - 각속도: 2000dps에서도 ~35 rad/s -> Q30으로 s64에 보관
+ *  - dt는 100ms로 잘라서 w * dt가 s64를 넘지 않게 함
+ */
+#include <linux/math64.h>
+#include <linux/minmax.h>
+#include <linux/int_sqrt.h>
+#include <linux/time64.h>
+
+#include "mpu9250_fusion.h"
+
+#define Q30_ONE                   (1LL << MY9250_Q30_SHIFT)
+#define MY9250_FUSION_DT_MAX_NS   (100 * NSEC_PER_MSEC)
+
+void my9250_fusion_reset(struct my9250_fusion *f, s32 kp, s32 ki)
+{
+	f->q[0] = Q30_ONE;
+	f->q[1] = f->q[2] = f->q[3] = 0;
+	f->eint[0] = f->eint[1] = f->eint[2] = 0;
+	f->kp = kp;
+	f->ki = ki;
+}
+
+void my9250_fusion_update(struct my9250_fusion *f, const s16 acc[3],
+			  const s16 gyr[3], s64 gyro_k, u32 dt_ns)
+{
+	s64 q0 = f->q[0], q1 = f->q[1], q2 = f->q[2], q3 = f->q[3];
+	s64 w[3], h[3], a[3], v[3], e[3], n[4];
+	u64 norm;
+	int i;
+
+	dt_ns = min_t(u32, dt_ns, MY9250_FUSION_DT_MAX_NS);
+
+	for (i = 0; i < 3; i++)
+		w[i] = gyr[i] * gyro_k;
+
+	/* 가속도가 0이면 (자유낙하 등) 보정 없이 gyro 적분만 */
+	norm = int_sqrt64((s64)acc[0] * acc[0] + (s64)acc[1] * acc[1] +
+			  (s64)acc[2] * acc[2]);
+	if (norm) {
+		for (i = 0; i < 3; i++)
+			a[i] = div64_s64(acc[i] * Q30_ONE, norm);
+
+		/* 현재 자세로 본 중력 방향 (회전행렬 3열) */
+		v[0] = (q1 * q3 - q0 * q2) >> (MY9250_Q30_SHIFT - 1);
+		v[1] = (q0 * q1 + q2 * q3) >> (MY9250_Q30_SHIFT - 1);
+		v[2] = (q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3) >> MY9250_Q30_SHIFT;
+
+		/* 오차 = 측정 중력 x 추정 중력, PI 제어로 gyro에 되먹임 */
+		e[0] = (a[1] * v[2] - a[2] * v[1]) >> MY9250_Q30_SHIFT;
+		e[1] = (a[2] * v[0] - a[0] * v[2]) >> MY9250_Q30_SHIFT;
+		e[2] = (a[0] * v[1] - a[1] * v[0]) >> MY9250_Q30_SHIFT;
+
+		for (i = 0; i < 3; i++) {
+			if (f->ki)
+				f->eint[i] += div_s64(((e[i] * f->ki) >> 16) * dt_ns,
+						      NSEC_PER_SEC);
+			w[i] += ((e[i] * f->kp) >> 16) + f->eint[i];
+		}
+	}
+
+	/* q += 0.5 * q (x) (0, w) * dt, h = w * dt / 2 (Q30 rad) */
+	for (i = 0; i < 3; i++)
+		h[i] = div_s64(w[i] * dt_ns, 2 * NSEC_PER_SEC);
+
+	n[0] = q0 + ((-q1 * h[0] - q2 * h[1] - q3 * h[2]) >> MY9250_Q30_SHIFT);
+	n[1] = q1 + ((q0 * h[0] + q2 * h[2] - q3 * h[1]) >> MY9250_Q30_SHIFT);
+	n[2] = q2 + ((q0 * h[1] - q1 * h[2] + q3 * h[0]) >> MY9250_Q30_SHIFT);
+	n[3] = q3 + ((q0 * h[2] + q1 * h[1] - q2 * h[0]) >> MY9250_Q30_SHIFT);
+
+	norm = int_sqrt64(n[0] * n[0] + n[1] * n[1] + n[2] * n[2] + n[3] * n[3]);
+	if (!norm) {
+		my9250_fusion_reset(f, f->kp, f->ki);
+		return;
+	}
+	for (i = 0; i < 4; i++)
+		f->q[i] = div64_s64(n[i] * Q30_ONE, norm);
+}
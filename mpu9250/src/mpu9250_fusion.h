@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * my-mpu9250 자세 추정: Mahony 6축 (accel + gyro) 필터, 전부 정수 연산.
+ * 커널에서는 FPU를 쓰지 않으므로 quaternion과 단위벡터는 Q30 고정소수점
+ */
+#ifndef _MY_MPU9250_FUSION_H
+#define _MY_MPU9250_FUSION_H
+
+#include <linux/types.h>
+
+#define MY9250_Q30_SHIFT          30
+
+struct my9250_fusion {
+	s32 q[4];       /* w, x, y, z (Q30), 항상 단위 quaternion */
+	s64 eint[3];    /* 적분 오차 (Q30 rad/s) */
+	s32 kp, ki;     /* 게인 (Q16) */
+};
+
+void my9250_fusion_reset(struct my9250_fusion *f, s32 kp, s32 ki);
+
+/*
+ * 샘플 하나로 갱신. acc/gyr는 raw, gyro_k는 gyro LSB당 rad/s (Q30),
+ * dt_ns는 샘플 간격
+ */
+void my9250_fusion_update(struct my9250_fusion *f, const s16 acc[3],
+			  const s16 gyr[3], s64 gyro_k, u32 dt_ns);
+
+#endif /* _MY_MPU9250_FUSION_H */
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * my-mpu9250 I2C glue. AD0로 주소가 0x68/0x69 두 개뿐이라 버스당 최대 2대,
+ * 더 필요하면 SPI (mpu9250_spi.c)
+ */
+#include <linux/module.h>
+#include <linux/i2c.h>
+#include <linux/regmap.h>
+
+#include "mpu9250.h"
+
+/* regmap-i2c와 같은 전송 (reg 쓰고 repeated start로 읽기) + 계측 */
+struct my9250_i2c {
+	struct i2c_client *client;
+	struct my9250_bus_stats stats;
+};
+
+static int my9250_i2c_write(void *context, const void *data, size_t count)
+{
+	struct my9250_i2c *mi = context;
+	u64 t0 = ktime_get_ns();
+	int ret = i2c_master_send(mi->client, data, count);
+
+	if (ret >= 0) ret = ret == count ? 0 : -EIO;
+	my9250_bus_account(&mi->stats, true, *(const u8 *)data, count, t0, ret);
+	return ret;
+}
+
+static int my9250_i2c_read(void *context, const void *reg, size_t reg_size,
+			   void *val, size_t val_size)
+{
+	struct my9250_i2c *mi = context;
+	struct i2c_msg msgs[] = {
+		{ .addr = mi->client->addr, .len = reg_size, .buf = (u8 *)reg },
+		{ .addr = mi->client->addr, .flags = I2C_M_RD, .len = val_size, .buf = val },
+	};
+	u64 t0 = ktime_get_ns();
+	int ret = i2c_transfer(mi->client->adapter, msgs, ARRAY_SIZE(msgs));
+
+	if (ret >= 0) ret = ret == ARRAY_SIZE(msgs) ? 0 : -EIO;
+	my9250_bus_account(&mi->stats, false, *(const u8 *)reg,
+			   reg_size + val_size, t0, ret);
+	return ret;
+}
+
+static const struct regmap_bus my9250_i2c_regmap_bus = {
+	.write = my9250_i2c_write,
+	.read = my9250_i2c_read,
+};
+
+static int my9250_i2c_probe(struct i2c_client *client)
+{
+	struct my9250_bus bus = {
+		.irq = client->irq,
+	};
+	struct my9250_i2c *mi;
+
+	mi = devm_kzalloc(&client->dev, sizeof(*mi), GFP_KERNEL);
+	if (!mi) return -ENOMEM;
+	mi->client = client;
+	mi->stats.dev = &client->dev;
+	bus.stats = &mi->stats;
+
+	/* I2C는 regmap_bulk_read 한 번이 곧 트랜잭션 한 번 */
+	bus.regmap = devm_regmap_init(&client->dev, &my9250_i2c_regmap_bus, mi,
+				      &my9250_regmap_config);
+	if (IS_ERR(bus.regmap)) return PTR_ERR(bus.regmap);
+
+	return my9250_core_probe(&client->dev, &bus);
+}
+
+static const struct of_device_id my9250_i2c_of_match[] = {
+	{ .compatible = "myvendor,my-mpu9250" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, my9250_i2c_of_match);
+
+static const struct i2c_device_id my9250_i2c_id[] = {
+	{ "my-mpu9250", 0 },
+	{ }
+};
+MODULE_DEVICE_TABLE(i2c, my9250_i2c_id);
+
+static struct i2c_driver my9250_i2c_driver = {
+	.driver = {
+		.name = "my-mpu9250",
+		.of_match_table = my9250_i2c_of_match,
+	},
+	.probe = my9250_i2c_probe,
+	.id_table = my9250_i2c_id,
+};
+module_i2c_driver(my9250_i2c_driver);
+
+MODULE_AUTHOR("you");
+MODULE_DESCRIPTION("Minimal MPU9250 IIO driver example - I2C");
+MODULE_LICENSE("GPL");
+MODULE_IMPORT_NS("MY9250");
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * my-mpu9250 SPI glue. 칩 사양: 설정 레지스터 R/W는 1MHz까지, 센서/인터럽트
+ * 레지스터 읽기는 20MHz까지. 그래서 regmap(설정)은 1MHz로 두고 데이터/FIFO
+ * 버스트만 transfer 단위로 20MHz를 요청 (컨트롤러 최대치로 잘릴 수 있음)
+ */
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/spi/spi.h>
+#include <linux/regmap.h>
+#include <linux/iio/iio.h>
+
+#include "mpu9250.h"
+
+#define MY9250_SPI_READ           0x80
+#define MY9250_SPI_CONFIG_HZ      1000000
+#define MY9250_SPI_READ_HZ        20000000
+
+struct my9250_spi {
+	struct spi_device *spi;
+	struct my9250_bus_stats stats;
+	struct mutex lock;   /* cmd 버퍼 보호 */
+	u8 cmd __aligned(IIO_DMA_MINALIGN);
+};
+
+static int my9250_spi_read_burst(void *ctx, unsigned int reg, void *buf, size_t len)
+{
+	struct my9250_spi *ms = ctx;
+	struct spi_transfer xfers[] = {
+		{ .tx_buf = &ms->cmd, .len = 1, .speed_hz = MY9250_SPI_READ_HZ },
+		{ .rx_buf = buf, .len = len, .speed_hz = MY9250_SPI_READ_HZ },
+	};
+	u64 t0;
+	int ret;
+
+	mutex_lock(&ms->lock);
+	ms->cmd = reg | MY9250_SPI_READ;
+	t0 = ktime_get_ns();
+	ret = spi_sync_transfer(ms->spi, xfers, ARRAY_SIZE(xfers));
+	mutex_unlock(&ms->lock);
+	my9250_bus_account(&ms->stats, false, reg, 1 + len, t0, ret);
+
+	return ret;
+}
+
+/*
+ * regmap(설정) 경로: regmap-spi와 같은 전송 + 계측. 읽기 비트(0x80)는
+ * regmap이 read_flag_mask로 reg 바이트에 붙여서 넘겨 줌
+ */
+static int my9250_spi_write(void *context, const void *data, size_t count)
+{
+	struct my9250_spi *ms = context;
+	u64 t0 = ktime_get_ns();
+	int ret = spi_write(ms->spi, data, count);
+
+	my9250_bus_account(&ms->stats, true, *(const u8 *)data, count, t0, ret);
+	return ret;
+}
+
+static int my9250_spi_read(void *context, const void *reg, size_t reg_size,
+			   void *val, size_t val_size)
+{
+	struct my9250_spi *ms = context;
+	u64 t0 = ktime_get_ns();
+	int ret = spi_write_then_read(ms->spi, reg, reg_size, val, val_size);
+
+	my9250_bus_account(&ms->stats, false, *(const u8 *)reg & ~MY9250_SPI_READ,
+			   reg_size + val_size, t0, ret);
+	return ret;
+}
+
+static const struct regmap_bus my9250_spi_regmap_bus = {
+	.write = my9250_spi_write,
+	.read = my9250_spi_read,
+	.read_flag_mask = MY9250_SPI_READ,
+};
+
+static int my9250_spi_probe(struct spi_device *spi)
+{
+	struct my9250_bus bus = {
+		.irq = spi->irq,
+		.is_spi = true,
+		.read_burst = my9250_spi_read_burst,
+	};
+	struct my9250_spi *ms;
+	int ret;
+
+	ms = devm_kzalloc(&spi->dev, sizeof(*ms), GFP_KERNEL);
+	if (!ms) return -ENOMEM;
+	ms->spi = spi;
+	ms->stats.dev = &spi->dev;
+	mutex_init(&ms->lock);
+	bus.ctx = ms;
+	bus.stats = &ms->stats;
+
+	/* regmap 경로(설정 쓰기 포함)는 1MHz 이하로 */
+	if (!spi->max_speed_hz || spi->max_speed_hz > MY9250_SPI_CONFIG_HZ) {
+		spi->max_speed_hz = MY9250_SPI_CONFIG_HZ;
+		ret = spi_setup(spi);
+		if (ret) return ret;
+	}
+
+	bus.regmap = devm_regmap_init(&spi->dev, &my9250_spi_regmap_bus, ms,
+				      &my9250_regmap_config);
+	if (IS_ERR(bus.regmap)) return PTR_ERR(bus.regmap);
+
+	return my9250_core_probe(&spi->dev, &bus);
+}
+
+static const struct of_device_id my9250_spi_of_match[] = {
+	{ .compatible = "myvendor,my-mpu9250" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, my9250_spi_of_match);
+
+static const struct spi_device_id my9250_spi_id[] = {
+	{ "my-mpu9250", 0 },
+	{ }
+};
+MODULE_DEVICE_TABLE(spi, my9250_spi_id);
+
+static struct spi_driver my9250_spi_driver = {
+	.driver = {
+		.name = "my-mpu9250",
+		.of_match_table = my9250_spi_of_match,
+	},
+	.probe = my9250_spi_probe,
+	.id_table = my9250_spi_id,
+};
+module_spi_driver(my9250_spi_driver);
+
+MODULE_AUTHOR("you");
+MODULE_DESCRIPTION("Minimal MPU9250 IIO driver example - SPI");
+MODULE_LICENSE("GPL");
+MODULE_IMPORT_NS("MY9250");
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * my-mpu9250 tracepoints. 켜기: echo 1 > /sys/kernel/tracing/events/my9250/enable
+ * 장치 구분은 dev 이름 (I2C 1-0068, SPI spi0.0 등). vl53l0x와 같은
+ * xfer/sample 구성이라 공유 버스 예산을 한 스크립트로 계산 가능
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM my9250
+
+#if !defined(_MY9250_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _MY9250_TRACE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+/* 버스 트랜잭션 하나: 시작 레지스터, reg 바이트 포함 바이트 수, 버스 시간 */
+TRACE_EVENT(my9250_xfer,
+	TP_PROTO(struct device *dev, bool write, u8 reg, size_t len, u64 ns, int ret),
+	TP_ARGS(dev, write, reg, len, ns, ret),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__field(bool, write)
+		__field(u8, reg)
+		__field(size_t, len)
+		__field(u64, ns)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		__assign_str(dev);
+		__entry->write = write;
+		__entry->reg = reg;
+		__entry->len = len;
+		__entry->ns = ns;
+		__entry->ret = ret;
+	),
+	TP_printk("%s %s reg=0x%02x len=%zu ns=%llu ret=%d",
+		  __get_str(dev), __entry->write ? "write" : "read", __entry->reg,
+		  __entry->len, __entry->ns, __entry->ret)
+);
+
+/* 데이터 읽기 하나 (FIFO면 n개 batch): IRQ/요청 시점부터의 지연 */
+TRACE_EVENT(my9250_sample,
+	TP_PROTO(struct device *dev, unsigned int n, s64 latency_ns),
+	TP_ARGS(dev, n, latency_ns),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__field(unsigned int, n)
+		__field(s64, latency_ns)
+	),
+	TP_fast_assign(
+		__assign_str(dev);
+		__entry->n = n;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk("%s n=%u latency_ns=%lld",
+		  __get_str(dev), __entry->n, __entry->latency_ns)
+);
+
+#endif /* _MY9250_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE mpu9250_trace
+#include <trace/define_trace.h>
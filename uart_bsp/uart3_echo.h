@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+// Userspace ABI for the uart3_serdev_echo character device (/dev/<name>, one per
+// bound UART, e.g. /dev/uart3_echo)
+// - Shared by the kernel module and userspace tools; keep it uapi-clean
+//   (only <linux/types.h> / <linux/ioctl.h>, fixed-width __u types)
+
+#ifndef _UAPI_UART3_ECHO_H
+#define _UAPI_UART3_ECHO_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * mmap() layout of the RX ring
+ *
+ *   offset 0          : control page (struct uart3_echo_ring_ctrl), map RW
+ *   offset data_offset: data_size bytes of received data, map read-only
+ *
+ * head and tail are free-running byte counters (they wrap at 2^32); the
+ * byte at position pos lives at data[pos & (data_size - 1)]. The kernel is
+ * the only writer of head, the consumer the only writer of tail:
+ *
+ *   head = __atomic_load_n(&ctrl->head, __ATOMIC_ACQUIRE);
+ *   ... consume data[tail .. head) ...
+ *   __atomic_store_n(&ctrl->tail, head, __ATOMIC_RELEASE);
+ *
+ * read() goes through a cursor of its own per open file, so several readers
+ * each see the whole stream without the kernel copying it per reader.
+ * Plain readers ("consumers") hold tail back: it only moves once every one
+ * of them has read the data, and that is what the overflow policy measures
+ * against. A file switched to UART3_ECHO_READER_F_TAP
+ * (UART3_ECHO_IOC_SET_READER) never holds tail back, e.g. a logger on a
+ * production link; it can still read data the consumers are done with
+ * until the kernel reuses that space. A reader that falls that far behind
+ * is lapped: it restarts at tail, poll() reports POLLPRI and the loss is
+ * counted (UART3_ECHO_IOC_GET_READER).
+ *
+ * A file that mmap()s the ring consumes through ctrl->tail itself, and
+ * while any file has it mapped only the mapping moves tail: read() users
+ * then behave like taps. poll()/epoll on that file report POLLIN while
+ * head != tail.
+ *
+ * With overflow-policy = "drop-oldest" the kernel may itself move tail
+ * forward to make room. Consumers then have to publish tail with a
+ * compare-and-swap against the value they started from, and treat a failed
+ * CAS as "what I copied may have been overwritten, start again".
+ *
+ * With overflow-policy = "backpressure" the kernel never drops data while
+ * it has room to hold it: RTS goes down at 3/4 full (uart-has-rtscts), and
+ * bytes that still arrive once the ring is full wait in a small in-kernel
+ * stash (one page) until a consumer frees space. They appear in the ring
+ * when that consumer next calls read() or poll(), or within one
+ * poll-period-ms for mmap users that do neither. A peer that keeps
+ * sending past the stash (no RTS/CTS) is held off in the tty buffer, and
+ * those bytes are only delivered once it sends more. Reconfiguring
+ * framing discards the stash along with the ring.
+ *
+ * head and tail sit on separate cache lines so the producer and consumer
+ * do not bounce the same line on every update.
+ */
+struct uart3_echo_ring_ctrl {
+	__u32 head;		/* written by the kernel */
+	__u32 __pad0[15];
+	__u32 tail;		/* written by the consumer */
+	__u32 __pad1[15];
+	__u32 data_offset;	/* byte offset of the data area in the mapping */
+	__u32 data_size;	/* size of the data area, power of two */
+	__u32 __reserved[14];
+};
+
+/*
+ * Framing stage (DT: framing = "none" | "slip" | "cobs" | "len-crc16" |
+ * "len-crc32", max-frame-size = <bytes>; or UART3_ECHO_IOC_SET_FRAMING).
+ *
+ * Wire formats understood by the decoder:
+ *   SLIP       RFC 1055: frames end with 0xC0, 0xDB escapes (0xDC/0xDD)
+ *   COBS       consistent overhead byte stuffing, frames end with 0x00
+ *   LEN_CRC16  le16 payload length, payload, le16 CRC-16/ARC
+ *   LEN_CRC32  le16 payload length, payload, le32 CRC-32 (IEEE 802.3)
+ * The CRC of the length-prefixed formats covers the length and payload.
+ *
+ * Only frames that decode cleanly and fit max_frame reach the ring; the
+ * rest are counted in debugfs stats. Switching framing discards whatever
+ * is buffered.
+ *
+ * With framing enabled the ring holds records instead of raw bytes: a
+ * struct uart3_echo_frame_hdr followed by len payload bytes, padded to
+ * UART3_ECHO_FRAME_ALIGN. read() then returns
+ *   - by default exactly one frame payload per call (-EMSGSIZE, frame kept,
+ *     if the buffer is smaller than the frame), or
+ *   - with UART3_ECHO_FRAMING_F_BATCH as many whole records (header,
+ *     payload, padding) as fit in the buffer.
+ * mmap consumers see the same records and must advance tail by whole
+ * records.
+ *
+ * Record mode (DT: rx-timestamps, or UART3_ECHO_FRAMING_F_TIMESTAMP)
+ * additionally stamps every record with the time the tty layer handed the
+ * data to the driver, as CLOCK_MONOTONIC and CLOCK_BOOTTIME nanoseconds
+ * (both from a single clock read). Without a framing type each receive_buf
+ * chunk becomes one record, split at max_frame; with one, a frame carries
+ * the time of the chunk that completed it. Timestamped records have
+ * UART3_ECHO_REC_F_TIMESTAMP in hdr.flags and a struct uart3_echo_tstamp
+ * between header and payload:
+ *
+ *   +0   struct uart3_echo_frame_hdr   len, flags
+ *   +8   struct uart3_echo_tstamp      mono_ns, boot_ns   (if F_TIMESTAMP)
+ *   +24  payload[len]
+ *        padding to UART3_ECHO_FRAME_ALIGN
+ *
+ * read() returns whole records in record mode (one per call, or as many as
+ * fit with UART3_ECHO_FRAMING_F_BATCH); walk them with UART3_ECHO_REC_SIZE().
+ */
+#define UART3_ECHO_FRAMING_NONE		0
+#define UART3_ECHO_FRAMING_SLIP		1
+#define UART3_ECHO_FRAMING_COBS		2
+#define UART3_ECHO_FRAMING_LEN_CRC16	3
+#define UART3_ECHO_FRAMING_LEN_CRC32	4
+
+#define UART3_ECHO_FRAMING_F_BATCH	(1U << 0)
+#define UART3_ECHO_FRAMING_F_TIMESTAMP	(1U << 1)
+
+/* uart3_echo_frame_hdr.flags */
+#define UART3_ECHO_REC_F_TIMESTAMP	(1U << 0)
+
+#define UART3_ECHO_FRAME_ALIGN		8
+#define UART3_ECHO_REC_PAYLOAD_OFFSET(flags) \
+	(sizeof(struct uart3_echo_frame_hdr) + \
+	 (((flags) & UART3_ECHO_REC_F_TIMESTAMP) ? sizeof(struct uart3_echo_tstamp) : 0))
+#define UART3_ECHO_REC_SIZE(len, flags) \
+	((UART3_ECHO_REC_PAYLOAD_OFFSET(flags) + (len) + UART3_ECHO_FRAME_ALIGN - 1) & \
+	 ~(UART3_ECHO_FRAME_ALIGN - 1))
+#define UART3_ECHO_FRAME_REC_SIZE(len)	UART3_ECHO_REC_SIZE(len, 0)
+
+struct uart3_echo_frame_hdr {
+	__u32 len;		/* payload bytes */
+	__u32 flags;		/* UART3_ECHO_REC_F_* */
+};
+
+struct uart3_echo_tstamp {
+	__u64 mono_ns;		/* CLOCK_MONOTONIC */
+	__u64 boot_ns;		/* CLOCK_BOOTTIME */
+};
+
+struct uart3_echo_framing {
+	__u32 type;		/* UART3_ECHO_FRAMING_* */
+	__u32 flags;		/* UART3_ECHO_FRAMING_F_* */
+	__u32 max_frame;	/* max payload bytes; 0 keeps the current limit */
+	__u32 __reserved;
+};
+
+/*
+ * Reader wakeup coalescing, per open file (defaults from DT:
+ * rx-wakeup-bytes, rx-wakeup-us), in the spirit of termios VMIN/VTIME.
+ *
+ * A blocking read() or poll()/epoll on this file only wakes up once
+ * min_bytes are buffered, or timeout_us after the first unread byte arrived
+ * (0 = no timeout, wait for min_bytes). min_bytes counts ring bytes, i.e.
+ * whole records with framing enabled; 0 and 1 both mean "any data", which
+ * is the default. O_NONBLOCK reads are not affected and return whatever is
+ * there.
+ */
+struct uart3_echo_wakeup {
+	__u32 min_bytes;	/* at most the ring data_size */
+	__u32 timeout_us;
+};
+
+/* Per open file, see the mmap() layout comment above */
+#define UART3_ECHO_READER_F_TAP		(1U << 0)
+
+struct uart3_echo_reader_info {
+	__u32 flags;		/* UART3_ECHO_READER_F_* */
+	__u32 overruns;		/* times lapped; GET returns and clears */
+	__u64 lost_bytes;	/* ring bytes skipped by those, or by read()
+				 * resyncing past a bad record header; GET
+				 * clears */
+};
+
+#define UART3_ECHO_IOC_MAGIC		'u'
+#define UART3_ECHO_IOC_SET_FRAMING	_IOW(UART3_ECHO_IOC_MAGIC, 0x01, struct uart3_echo_framing)
+#define UART3_ECHO_IOC_GET_FRAMING	_IOR(UART3_ECHO_IOC_MAGIC, 0x02, struct uart3_echo_framing)
+#define UART3_ECHO_IOC_SET_WAKEUP	_IOW(UART3_ECHO_IOC_MAGIC, 0x03, struct uart3_echo_wakeup)
+#define UART3_ECHO_IOC_GET_WAKEUP	_IOR(UART3_ECHO_IOC_MAGIC, 0x04, struct uart3_echo_wakeup)
+#define UART3_ECHO_IOC_SET_READER	_IOW(UART3_ECHO_IOC_MAGIC, 0x05, struct uart3_echo_reader_info)
+#define UART3_ECHO_IOC_GET_READER	_IOR(UART3_ECHO_IOC_MAGIC, 0x06, struct uart3_echo_reader_info)
+
+#endif /* _UAPI_UART3_ECHO_H */
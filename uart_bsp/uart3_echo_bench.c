@@ -0,0 +1,546 @@
+// Userspace benchmark for the uart3_serdev_echo character device
+// - Sends sequence-numbered, timestamped messages and reads them back,
+//   reporting TX/RX throughput, loss, syscalls per MB and p50/p99/p99.9
+//   end-to-end latency for every baud rate x read size x read mode
+// - Links it can measure:
+//     loopback  /dev/uart3_echo with TX wired to RX (echo off), default
+//     --peer    another tty on the same wire feeds the device (RX path);
+//               with --reverse the device sends and the peer reads (TX path)
+//     --pty     a pty pair, no hardware at all: checks the tool itself and
+//               gives the plain tty-layer baseline to compare against
+// - The device's own baud comes from DT (current-speed); --baud sets the
+//   peer/pty side and the pacing (10 bits per byte, --load of the line rate)
+// - Build: make bench (CC=arm-linux-gnueabihf-gcc to cross-compile)
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "uart3_echo.h"
+
+#define BENCH_MAGIC 0x55AA33CCu
+#define BENCH_MAX_LIST 16
+#define BENCH_DRAIN_IDLE_MS 300
+
+struct bench_msg {
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t t_ns; /* CLOCK_MONOTONIC at write() */
+};
+
+enum bench_mode { MODE_BLOCK, MODE_POLL };
+static const char * const mode_names[] = { "block", "poll" };
+
+struct bench_cfg {
+    const char *dev;
+    const char *peer;
+    bool reverse;
+    bool pty;
+    bool csv;
+    unsigned int bauds[BENCH_MAX_LIST], nbauds;
+    unsigned int rsizes[BENCH_MAX_LIST], nrsizes;
+    enum bench_mode modes[2];
+    unsigned int nmodes;
+    unsigned int msg_size;
+    double load;     /* fraction of the line rate; 0 = unpaced */
+    double duration; /* seconds of sending per run */
+    unsigned int vmin, vtime_us; /* UART3_ECHO_IOC_SET_WAKEUP, device RX only */
+};
+
+struct bench_run {
+    const struct bench_cfg *cfg;
+    unsigned int baud;
+    unsigned int rsize;
+    enum bench_mode mode;
+    int tx_fd, rx_fd;
+    pthread_t reader;
+    atomic_bool writer_done, reader_done;
+    /* writer */
+    uint64_t tx_bytes, tx_msgs, tx_syscalls;
+    double tx_secs;
+    /* reader */
+    uint64_t rx_bytes, rx_msgs, rx_resync_bytes, rx_syscalls;
+    double rx_secs;
+    uint32_t *lat_ns;
+    size_t nlat, cap_lat;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static speed_t baud_to_speed(unsigned int baud)
+{
+    static const struct { unsigned int baud; speed_t speed; } map[] = {
+        { 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 },
+        { 57600, B57600 }, { 115200, B115200 }, { 230400, B230400 },
+        { 460800, B460800 }, { 921600, B921600 }, { 1000000, B1000000 },
+        { 2000000, B2000000 }, { 3000000, B3000000 }, { 4000000, B4000000 },
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(map) / sizeof(map[0]); i++)
+        if (map[i].baud == baud)
+            return map[i].speed;
+    return 0;
+}
+
+/* Raw 8N1 at baud; a no-op for anything that is not a tty (the chardev). */
+static int setup_tty(int fd, unsigned int baud)
+{
+    struct termios tio;
+    speed_t speed = baud_to_speed(baud);
+
+    if (!isatty(fd))
+        return 0;
+    if (tcgetattr(fd, &tio))
+        return -1;
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    if (speed)
+        cfsetspeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio))
+        return -1;
+    tcflush(fd, TCIOFLUSH);
+    return 0;
+}
+
+static int open_or_die(const char *path, int flags)
+{
+    int fd = open(path, flags | O_NOCTTY | O_CLOEXEC);
+
+    if (fd < 0) {
+        fprintf(stderr, "open %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    return fd;
+}
+
+/* Opens the two ends for one run: tx_fd feeds the link, rx_fd drains it. */
+static void open_link(struct bench_run *run)
+{
+    const struct bench_cfg *cfg = run->cfg;
+
+    if (cfg->pty) {
+        int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+
+        if (master < 0 || grantpt(master) || unlockpt(master)) {
+            perror("pty");
+            exit(1);
+        }
+        run->tx_fd = master;
+        run->rx_fd = open_or_die(ptsname(master), O_RDWR);
+    } else if (cfg->peer) {
+        int dev = open_or_die(cfg->dev, O_RDWR);
+        int peer = open_or_die(cfg->peer, O_RDWR);
+
+        run->tx_fd = cfg->reverse ? dev : peer;
+        run->rx_fd = cfg->reverse ? peer : dev;
+    } else {
+        /* two opens: the reader's O_NONBLOCK must not leak into the writer */
+        run->tx_fd = open_or_die(cfg->dev, O_WRONLY);
+        run->rx_fd = open_or_die(cfg->dev, O_RDONLY);
+    }
+
+    if (setup_tty(run->tx_fd, run->baud) || setup_tty(run->rx_fd, run->baud)) {
+        perror("termios");
+        exit(1);
+    }
+
+    if (cfg->vmin || cfg->vtime_us) {
+        struct uart3_echo_wakeup w = { .min_bytes = cfg->vmin, .timeout_us = cfg->vtime_us };
+
+        if (ioctl(run->rx_fd, UART3_ECHO_IOC_SET_WAKEUP, &w))
+            fprintf(stderr, "UART3_ECHO_IOC_SET_WAKEUP: %s (ignored)\n", strerror(errno));
+    }
+}
+
+static void close_link(struct bench_run *run)
+{
+    close(run->tx_fd);
+    close(run->rx_fd);
+}
+
+/* Leftovers from the previous run would show up as resync bytes. */
+static void drain(int fd)
+{
+    char buf[4096];
+    int flags = fcntl(fd, F_GETFL);
+
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    usleep(BENCH_DRAIN_IDLE_MS * 1000);
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+    fcntl(fd, F_SETFL, flags);
+}
+
+static void *writer_main(void *arg)
+{
+    struct bench_run *run = arg;
+    const struct bench_cfg *cfg = run->cfg;
+    double rate = cfg->load > 0 ? run->baud / 10.0 * cfg->load : 0; /* bytes/s */
+    /* one write per ~1 ms of line time, at least one message */
+    size_t batch = rate ? (size_t)(rate / 1000 / cfg->msg_size) : 64;
+    uint64_t start, deadline, t;
+    uint32_t seq = 0;
+    uint8_t *buf;
+    size_t i;
+
+    if (!batch)
+        batch = 1;
+    buf = calloc(batch, cfg->msg_size);
+    if (!buf)
+        exit(1);
+
+    start = now_ns();
+    deadline = start + (uint64_t)(cfg->duration * 1e9);
+    while ((t = now_ns()) < deadline) {
+        size_t len = batch * cfg->msg_size, off = 0;
+
+        for (i = 0; i < batch; i++) {
+            struct bench_msg *m = (struct bench_msg *)(buf + i * cfg->msg_size);
+            size_t j;
+
+            m->magic = BENCH_MAGIC;
+            m->seq = seq++;
+            m->t_ns = t;
+            for (j = sizeof(*m); j < cfg->msg_size; j++)
+                buf[i * cfg->msg_size + j] = (uint8_t)(m->seq + j);
+        }
+        while (off < len) {
+            ssize_t n = write(run->tx_fd, buf + off, len - off);
+
+            run->tx_syscalls++;
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN)
+                    continue;
+                perror("write");
+                goto out;
+            }
+            off += n;
+        }
+        run->tx_bytes += len;
+        run->tx_msgs += batch;
+
+        if (rate) {
+            /* pace against the schedule, not the last write, so we do not drift */
+            uint64_t due = start + (uint64_t)(run->tx_bytes / rate * 1e9);
+            struct timespec ts = { .tv_sec = due / 1000000000ull, .tv_nsec = due % 1000000000ull };
+
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+    }
+out:
+    run->tx_secs = (now_ns() - start) / 1e9;
+    free(buf);
+
+    /*
+     * A blocking read() on a quiet link never returns by itself; keep
+     * knocking (no SA_RESTART) until the reader notices, which also covers
+     * the signal landing just before it enters read().
+     */
+    atomic_store(&run->writer_done, true);
+    while (!atomic_load(&run->reader_done)) {
+        pthread_kill(run->reader, SIGUSR1);
+        usleep(50000);
+    }
+    return NULL;
+}
+
+static void record_latency(struct bench_run *run, uint64_t ns)
+{
+    if (run->nlat == run->cap_lat) {
+        size_t cap = run->cap_lat ? run->cap_lat * 2 : 65536;
+        uint32_t *p = realloc(run->lat_ns, cap * sizeof(*p));
+
+        if (!p)
+            return;
+        run->lat_ns = p;
+        run->cap_lat = cap;
+    }
+    run->lat_ns[run->nlat++] = ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+}
+
+/* Splits the received stream back into messages; returns bytes consumed. */
+static size_t parse(struct bench_run *run, const uint8_t *buf, size_t len, uint64_t t)
+{
+    unsigned int msg_size = run->cfg->msg_size;
+    size_t off = 0;
+
+    while (len - off >= msg_size) {
+        struct bench_msg m;
+
+        memcpy(&m, buf + off, sizeof(m));
+        if (m.magic != BENCH_MAGIC) {
+            off++;
+            run->rx_resync_bytes++;
+            continue;
+        }
+        run->rx_msgs++;
+        record_latency(run, t - m.t_ns);
+        off += msg_size;
+    }
+    return off;
+}
+
+static void reader_main(struct bench_run *run, pthread_t writer)
+{
+    size_t cap = run->rsize + run->cfg->msg_size;
+    uint8_t *buf = malloc(cap);
+    size_t have = 0;
+    uint64_t start = 0, last = 0, idle_ns = BENCH_DRAIN_IDLE_MS * 1000000ull;
+    bool writer_done = false;
+    struct pollfd pfd = { .fd = run->rx_fd, .events = POLLIN };
+
+    if (!buf)
+        exit(1);
+    if (run->mode == MODE_POLL)
+        fcntl(run->rx_fd, F_SETFL, fcntl(run->rx_fd, F_GETFL) | O_NONBLOCK);
+
+    for (;;) {
+        ssize_t n;
+        uint64_t t;
+
+        if (!writer_done && atomic_load(&run->writer_done)) {
+            writer_done = true;
+            last = now_ns();
+        }
+
+        if (run->mode == MODE_POLL || writer_done) {
+            /* after the writer is done, stop once the link stays quiet */
+            int ret = poll(&pfd, 1, writer_done ? BENCH_DRAIN_IDLE_MS : 100);
+
+            run->rx_syscalls++;
+            if (ret < 0 && errno != EINTR)
+                break;
+            if (ret <= 0) {
+                if (writer_done && now_ns() - last >= idle_ns)
+                    break;
+                continue;
+            }
+        }
+
+        n = read(run->rx_fd, buf + have, run->rsize);
+        run->rx_syscalls++;
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            perror("read");
+            break;
+        }
+        if (n == 0)
+            break;
+
+        t = now_ns();
+        if (!start)
+            start = t;
+        last = t;
+        run->rx_bytes += n;
+        have += n;
+        n = parse(run, buf, have, t);
+        memmove(buf, buf + n, have - n);
+        have -= n;
+    }
+
+    atomic_store(&run->reader_done, true);
+    pthread_join(writer, NULL);
+    run->rx_secs = start && last > start ? (last - start) / 1e9 : 0;
+    free(buf);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double pct_us(const struct bench_run *run, double p)
+{
+    size_t i;
+
+    if (!run->nlat)
+        return 0;
+    i = (size_t)(p * (run->nlat - 1) + 0.5);
+    return run->lat_ns[i] / 1000.0;
+}
+
+static void report(const struct bench_run *run, bool csv)
+{
+    double mb = run->rx_bytes / 1e6;
+    double loss = run->tx_msgs ? 100.0 * (run->tx_msgs - run->rx_msgs) / run->tx_msgs : 0;
+
+    if (csv) {
+        printf("%u,%u,%s,%.1f,%.1f,%.3f,%" PRIu64 ",%.0f,%.1f,%.1f,%.1f\n",
+               run->baud, run->rsize, mode_names[run->mode],
+               run->tx_secs ? run->tx_bytes / run->tx_secs / 1e3 : 0,
+               run->rx_secs ? run->rx_bytes / run->rx_secs / 1e3 : 0,
+               loss, run->rx_resync_bytes, mb ? run->rx_syscalls / mb : 0,
+               pct_us(run, 0.50), pct_us(run, 0.99), pct_us(run, 0.999));
+        return;
+    }
+    printf("%8u %6u %-5s %9.1f %9.1f %7.3f %8" PRIu64 " %9.0f %9.1f %9.1f %9.1f\n",
+           run->baud, run->rsize, mode_names[run->mode],
+           run->tx_secs ? run->tx_bytes / run->tx_secs / 1e3 : 0,
+           run->rx_secs ? run->rx_bytes / run->rx_secs / 1e3 : 0,
+           loss, run->rx_resync_bytes, mb ? run->rx_syscalls / mb : 0,
+           pct_us(run, 0.50), pct_us(run, 0.99), pct_us(run, 0.999));
+}
+
+static void run_one(const struct bench_cfg *cfg, unsigned int baud, unsigned int rsize,
+                    enum bench_mode mode)
+{
+    struct bench_run run = {
+        .cfg = cfg, .baud = baud, .rsize = rsize, .mode = mode,
+    };
+    pthread_t writer;
+
+    run.reader = pthread_self();
+    open_link(&run);
+    drain(run.rx_fd);
+    if (pthread_create(&writer, NULL, writer_main, &run)) {
+        perror("pthread_create");
+        exit(1);
+    }
+    reader_main(&run, writer);
+    close_link(&run);
+
+    qsort(run.lat_ns, run.nlat, sizeof(*run.lat_ns), cmp_u32);
+    report(&run, cfg->csv);
+    fflush(stdout);
+    free(run.lat_ns);
+}
+
+static unsigned int parse_list(const char *arg, unsigned int *out)
+{
+    char *copy = strdup(arg), *tok, *save = NULL;
+    unsigned int n = 0;
+
+    for (tok = strtok_r(copy, ",", &save); tok && n < BENCH_MAX_LIST;
+         tok = strtok_r(NULL, ",", &save))
+        out[n++] = strtoul(tok, NULL, 0);
+    free(copy);
+    return n;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -d, --dev PATH         device under test (default /dev/uart3_echo)\n"
+            "  -p, --peer PATH        tty on the other end of the wire\n"
+            "  -r, --reverse          with --peer: device sends, peer receives\n"
+            "  -P, --pty              pty pair stand-in, no hardware\n"
+            "  -b, --baud LIST        e.g. 115200,921600 (default 115200)\n"
+            "  -s, --read-size LIST   read() sizes, e.g. 1,64,4096 (default 64,4096)\n"
+            "  -m, --mode LIST        block,poll (default both)\n"
+            "  -l, --load FRAC        offered load vs. line rate, 0 = unpaced (default 0.9)\n"
+            "  -t, --duration SEC     sending time per run (default 5)\n"
+            "  -S, --msg-size BYTES   message size, >= 16 (default 32)\n"
+            "  -n, --vmin BYTES       UART3_ECHO_IOC_SET_WAKEUP min_bytes on the RX fd\n"
+            "  -T, --vtime US         UART3_ECHO_IOC_SET_WAKEUP timeout_us on the RX fd\n"
+            "  -c, --csv              CSV output\n", prog);
+    exit(2);
+}
+
+static void on_sigusr1(int sig)
+{
+    (void)sig;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option opts[] = {
+        { "dev", required_argument, NULL, 'd' },
+        { "peer", required_argument, NULL, 'p' },
+        { "reverse", no_argument, NULL, 'r' },
+        { "pty", no_argument, NULL, 'P' },
+        { "baud", required_argument, NULL, 'b' },
+        { "read-size", required_argument, NULL, 's' },
+        { "mode", required_argument, NULL, 'm' },
+        { "load", required_argument, NULL, 'l' },
+        { "duration", required_argument, NULL, 't' },
+        { "msg-size", required_argument, NULL, 'S' },
+        { "vmin", required_argument, NULL, 'n' },
+        { "vtime", required_argument, NULL, 'T' },
+        { "csv", no_argument, NULL, 'c' },
+        { NULL, 0, NULL, 0 }
+    };
+    struct bench_cfg cfg = {
+        .dev = "/dev/uart3_echo",
+        .bauds = { 115200 }, .nbauds = 1,
+        .rsizes = { 64, 4096 }, .nrsizes = 2,
+        .modes = { MODE_BLOCK, MODE_POLL }, .nmodes = 2,
+        .msg_size = 32,
+        .load = 0.9,
+        .duration = 5,
+    };
+    struct sigaction sa = { .sa_handler = on_sigusr1 };
+    unsigned int b, s, m;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "d:p:rPb:s:m:l:t:S:n:T:c", opts, NULL)) != -1) {
+        switch (c) {
+        case 'd': cfg.dev = optarg; break;
+        case 'p': cfg.peer = optarg; break;
+        case 'r': cfg.reverse = true; break;
+        case 'P': cfg.pty = true; break;
+        case 'b': cfg.nbauds = parse_list(optarg, cfg.bauds); break;
+        case 's': cfg.nrsizes = parse_list(optarg, cfg.rsizes); break;
+        case 'm':
+            cfg.nmodes = 0;
+            if (strstr(optarg, "block"))
+                cfg.modes[cfg.nmodes++] = MODE_BLOCK;
+            if (strstr(optarg, "poll"))
+                cfg.modes[cfg.nmodes++] = MODE_POLL;
+            break;
+        case 'l': cfg.load = strtod(optarg, NULL); break;
+        case 't': cfg.duration = strtod(optarg, NULL); break;
+        case 'S': cfg.msg_size = strtoul(optarg, NULL, 0); break;
+        case 'n': cfg.vmin = strtoul(optarg, NULL, 0); break;
+        case 'T': cfg.vtime_us = strtoul(optarg, NULL, 0); break;
+        case 'c': cfg.csv = true; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (cfg.msg_size < sizeof(struct bench_msg) || !cfg.nbauds || !cfg.nrsizes ||
+        !cfg.nmodes || cfg.duration <= 0)
+        usage(argv[0]);
+
+    sigaction(SIGUSR1, &sa, NULL);
+
+    if (cfg.csv)
+        printf("baud,read_size,mode,tx_kBps,rx_kBps,loss_pct,resync_bytes,syscalls_per_MB,"
+               "p50_us,p99_us,p999_us\n");
+    else
+        printf("%8s %6s %-5s %9s %9s %7s %8s %9s %9s %9s %9s\n",
+               "baud", "rsize", "mode", "tx kB/s", "rx kB/s", "loss%", "resync",
+               "sys/MB", "p50 us", "p99 us", "p999 us");
+
+    for (b = 0; b < cfg.nbauds; b++)
+        for (s = 0; s < cfg.nrsizes; s++)
+            for (m = 0; m < cfg.nmodes; m++)
+                run_one(&cfg, cfg.bauds[b], cfg.rsizes[s], cfg.modes[m]);
+    return 0;
+}
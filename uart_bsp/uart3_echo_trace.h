@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+// Tracepoints for uart3_serdev_echo
+// - Enable with: echo 1 > /sys/kernel/tracing/events/uart3_echo/enable
+// - Instances are told apart by the misc device minor
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM uart3_echo
+
+#if !defined(_UART3_ECHO_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _UART3_ECHO_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(uart3_echo_rx,
+	TP_PROTO(int minor, size_t count, size_t accepted, u32 level),
+	TP_ARGS(minor, count, accepted, level),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(size_t, count)
+		__field(size_t, accepted)
+		__field(u32, level)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->count = count;
+		__entry->accepted = accepted;
+		__entry->level = level;
+	),
+	TP_printk("minor=%d count=%zu accepted=%zu level=%u",
+		  __entry->minor, __entry->count, __entry->accepted,
+		  __entry->level)
+);
+
+TRACE_EVENT(uart3_echo_overflow,
+	TP_PROTO(int minor, size_t dropped, u32 level),
+	TP_ARGS(minor, dropped, level),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(size_t, dropped)
+		__field(u32, level)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->dropped = dropped;
+		__entry->level = level;
+	),
+	TP_printk("minor=%d dropped=%zu level=%u",
+		  __entry->minor, __entry->dropped, __entry->level)
+);
+
+TRACE_EVENT(uart3_echo_wakeup,
+	TP_PROTO(int minor, u32 level),
+	TP_ARGS(minor, level),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(u32, level)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->level = level;
+	),
+	TP_printk("minor=%d level=%u", __entry->minor, __entry->level)
+);
+
+TRACE_EVENT(uart3_echo_throttle,
+	TP_PROTO(int minor, bool throttled, u32 level),
+	TP_ARGS(minor, throttled, level),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(bool, throttled)
+		__field(u32, level)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->throttled = throttled;
+		__entry->level = level;
+	),
+	TP_printk("minor=%d %s level=%u", __entry->minor,
+		  __entry->throttled ? "throttle" : "unthrottle", __entry->level)
+);
+
+TRACE_EVENT(uart3_echo_tx,
+	TP_PROTO(int minor, size_t count, int written),
+	TP_ARGS(minor, count, written),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(size_t, count)
+		__field(int, written)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->count = count;
+		__entry->written = written;
+	),
+	TP_printk("minor=%d count=%zu written=%d",
+		  __entry->minor, __entry->count, __entry->written)
+);
+
+#endif /* _UART3_ECHO_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE uart3_echo_trace
+#include <trace/define_trace.h>
@@ -1,13 +1,33 @@
 // Minimal serdev client driver for UART3 on Raspberry Pi (BCM2711)
-// - Binds to a serdev child under &uart3 via DT compatible
-// - Opens the serial port, sets baudrate, logs received bytes
+// - Binds to a serdev child under &uart3 via DT compatible; any number of
+//   UARTs can carry one, each gets its own /dev/<name> (DT label, else
+//   uart<N>_echo from the controller's alias, else <serdev name>_echo)
+// - Opens the serial port, sets baudrate, counts/traces received bytes
 // - Optional echo-back (disable if using TX<->RX loopback to avoid storms)
+// - RX bytes land in an mmap()-able ring (see uart3_echo.h) so userspace can
+//   consume them either with read() or zero-copy from the shared pages
+// - Every open file reads through its own cursor over that one ring, so a
+//   logger/monitor (a "tap") can watch a link without stealing its bytes
+// - Overflow policy (DT: overflow-policy) is drop-newest, drop-oldest or
+//   backpressure (RTS/CTS, plus a small stash the driver replays into the
+//   ring once a consumer makes room)
+// - TX goes through a kernel FIFO drained from write_wakeup, so write()
+//   blocks (or -EAGAIN) only when that FIFO is full and poll() has POLLOUT
+// - Optional framing stage (SLIP, COBS, length+CRC16/32; DT: framing or
+//   ioctl) turning the ring into validated frame records for read()
+// - Optional record mode (DT: rx-timestamps) stamping each chunk/frame with
+//   its monotonic and boottime arrival time
+// - Reader wakeups are coalesced per open file (N bytes or T us after the
+//   first unread byte; DT: rx-wakeup-bytes/rx-wakeup-us, or ioctl)
+// - No printk on the data path: tracepoints (uart3_echo_trace.h) plus a
+//   debugfs stats block (/sys/kernel/debug/<name>/stats)
+// - Read and write readiness use separate, keyed wakeups so one epoll set
+//   over many instances is only woken for the events it asked for
 
 #include <linux/module.h>
 #include <linux/serdev.h>
 #include <linux/of_device.h>
 #include <linux/of.h>
-#include <linux/kfifo.h>
 #include <linux/workqueue.h>
 #include <linux/spinlock.h>
 #include <linux/string.h>
@@ -15,81 +35,980 @@
 #include <linux/miscdevice.h>
 #include <linux/poll.h>
 #include <linux/uaccess.h>
+#include <linux/uio.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/fs.h>
+#include <linux/kfifo.h>
+#include <linux/crc16.h>
+#include <linux/crc32.h>
+#include <linux/unaligned.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
+#include <linux/mutex.h>
+#include <linux/rwsem.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/timekeeping.h>
+#include <linux/hrtimer.h>
+#include <linux/list.h>
+#include <linux/kref.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "uart3_echo.h"
+
+#define CREATE_TRACE_POINTS
+#include "uart3_echo_trace.h"
+
+#define UART3_ECHO_RX_RING_SIZE 4096 /* default, DT: rx-fifo-size */
+#define UART3_ECHO_TX_FIFO_SIZE 4096 /* default, DT: tx-fifo-size */
+#define UART3_ECHO_MAX_FRAME 1024    /* default, DT: max-frame-size */
+
+#define SLIP_END     0xC0
+#define SLIP_ESC     0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+#define UART3_ECHO_NAME_LEN 32
+
+#define UART3_ECHO_RX_MARKS 64     /* in-flight chunks tracked for latency */
+#define UART3_ECHO_LAT_BUCKETS 16  /* log2(us) buckets, last one open-ended */
+#define UART3_ECHO_STASH_SIZE PAGE_SIZE /* backpressure: bytes held past a full ring */
+
+/*
+ * Single-producer/single-consumer byte ring backing /dev/<name>.
+ * buf is one vmalloc_user() area: a control page followed by the data pages,
+ * so the whole thing can be handed to remap_vmalloc_range() as is.
+ */
+struct uart3_echo_ring {
+    void *buf;
+    size_t buf_len;
+    struct uart3_echo_ring_ctrl *ctrl;
+    u8 *data;
+    u32 size; /* data bytes, power of two */
+    u32 head; /* producer position; ctrl->head is only ever a published copy */
+    u32 claim; /* end of what the producer is writing; see uart3_echo_read_commit() */
+};
+
+/* What receive_buf does when the RX ring cannot take a whole chunk */
+enum uart3_echo_overflow {
+    UART3_ECHO_DROP_NEWEST,  /* keep what fits, drop the rest of the chunk */
+    UART3_ECHO_DROP_OLDEST,  /* evict unread bytes to make room */
+    UART3_ECHO_BACKPRESSURE, /* stash what does not fit, drop RTS */
+};
+
+static const char * const uart3_echo_overflow_names[] = {
+    [UART3_ECHO_DROP_NEWEST] = "drop-newest",
+    [UART3_ECHO_DROP_OLDEST] = "drop-oldest",
+    [UART3_ECHO_BACKPRESSURE] = "backpressure",
+};
+
+static const char * const uart3_echo_framing_names[] = {
+    [UART3_ECHO_FRAMING_NONE] = "none",
+    [UART3_ECHO_FRAMING_SLIP] = "slip",
+    [UART3_ECHO_FRAMING_COBS] = "cobs",
+    [UART3_ECHO_FRAMING_LEN_CRC16] = "len-crc16",
+    [UART3_ECHO_FRAMING_LEN_CRC32] = "len-crc32",
+};
+
+/*
+ * Framing decoder state, owned by the producer (under rx_lock).
+ * buf holds the payload decoded so far; for the length-prefixed formats it
+ * holds the raw frame (length, payload, CRC) since the CRC covers it all.
+ */
+struct uart3_echo_decoder {
+    u8 *buf;
+    u32 len;
+    bool discard;   /* bad frame: drop bytes until the next delimiter */
+    bool resync;    /* length+CRC: hunting for a valid header */
+    bool esc;       /* SLIP: previous byte was SLIP_ESC */
+    bool cobs_first;
+    u8 cobs_code;
+    u8 cobs_left;
+};
 
+/*
+ * One per open file. The wakeup threshold and timer are per reader, so a
+ * bulk consumer can batch while an interactive one still sees every byte.
+ * expired is set by the timer and cleared when the ring goes from empty to
+ * non-empty, which is when "first unread byte" starts counting.
+ *
+ * pos is this file's own read cursor into the shared ring; consumers hold
+ * ctrl->tail back to the slowest of them, taps do not. A file that has
+ * mapped the ring reads through ctrl->tail instead (mapped).
+ */
+struct uart3_echo_reader {
+    struct uart3_echo_priv *priv;
+    struct list_head node; /* on priv->readers */
+    wait_queue_head_t wq;
+    struct hrtimer timer;
+    u32 min_bytes;
+    u32 timeout_us;
+    bool expired;
+    struct mutex lock; /* serializes read() on this file */
+    u32 pos;     /* written under readers_lock */
+    u32 flags;   /* UART3_ECHO_READER_F_* */
+    bool mapped;
+    u32 overruns;
+    u64 lost_bytes;
+};
+
+/* Arrival time of a receive_buf chunk, keyed by the ring position after it */
+struct uart3_echo_rx_mark {
+    u32 end;
+    ktime_t ts;
+};
+
+/*
+ * Counters are bumped once per chunk/read, never per byte. rx_hwm is only
+ * written by the producer, so it does not need to be atomic.
+ */
+struct uart3_echo_stats {
+    atomic64_t rx_bytes;
+    atomic64_t rx_dropped;
+    atomic64_t tx_bytes;
+    atomic64_t tx_dropped;
+    atomic64_t rx_stalls;    /* chunks that found the ring full (backpressure) */
+    atomic64_t rx_throttled; /* RTS deassert events */
+    atomic64_t rx_frames;
+    atomic64_t rx_frame_errors;
+    atomic64_t rx_frames_dropped; /* valid frames that did not fit */
+    atomic64_t rx_wakeups;
+    atomic64_t rx_overruns; /* readers lapped by the producer */
+    atomic64_t rx_resyncs;  /* read() skipped past a bad record header */
+    u32 rx_hwm;
+    atomic64_t read_lat[UART3_ECHO_LAT_BUCKETS];
+};
+
+/*
+ * Per instance; nothing is shared between UARTs. Open files hold a
+ * reference, so priv (and the ring they may have mapped) outlives remove();
+ * gone tells them the UART went away.
+ */
 struct uart3_echo_priv {
+    struct kref ref;
+    bool gone;
+    char name[UART3_ECHO_NAME_LEN];
     struct serdev_device *serdev;
     bool echo_back;
     u32 baud;
-    /* Byte FIFO and polling to process data every N ms */
-    struct kfifo fifo;
-    spinlock_t fifo_lock;
+    bool flow_control; /* DT: uart-has-rtscts */
+    enum uart3_echo_overflow overflow; /* DT: overflow-policy */
+    /* Backpressure: RTS drops above 3/4 full and comes back below 1/4 */
+    struct mutex flow_lock;
+    bool throttled;
+    /*
+     * Backpressure: bytes receive_buf took while the ring was full. The tty
+     * layer only re-offers what we leave it on its next push, which may
+     * never come once RTS is down, so we keep them and rx_kick_work feeds
+     * them to the ring when a consumer makes room.
+     */
+    u8 *stash;
+    u32 stash_len; /* under rx_lock */
+    struct work_struct rx_kick_work;
+    /* RX ring and polling to process data every N ms */
+    struct uart3_echo_ring rx;
+    struct rw_semaphore read_lock; /* read() vs. reconfiguration of rx */
+    struct mutex rx_lock;   /* producer state vs. reconfiguration */
+    struct uart3_echo_framing framing;
+    struct uart3_echo_decoder dec;
+    struct uart3_echo_tstamp rx_ts; /* arrival of the current chunk */
     struct delayed_work poll_work;
     u32 period_ms; /* default 1000ms, DT: poll-period-ms */
+    /* TX FIFO: filled by write() and echo, drained by tx_work */
+    struct kfifo tx_fifo;
+    struct mutex tx_lock; /* serializes tx_fifo producers */
+    struct work_struct tx_work;
+    wait_queue_head_t write_wq;
     /* Userspace char device interface */
     struct miscdevice miscdev;
-    wait_queue_head_t read_wq;
+    spinlock_t readers_lock; /* readers list, their cursors and thresholds */
+    struct list_head readers;
+    unsigned int mappers; /* files that mapped the ring; they own tail */
+    struct uart3_echo_wakeup wakeup; /* default for new readers */
+    /* Instrumentation: marks are produced by receive_buf, consumed by read() */
+    struct uart3_echo_rx_mark rx_marks[UART3_ECHO_RX_MARKS];
+    u32 rx_mark_head;
+    u32 rx_mark_tail; /* under readers_lock */
+    struct uart3_echo_stats stats;
+    struct dentry *debugfs;
 };
 
+static int uart3_echo_ring_alloc(struct uart3_echo_ring *ring, u32 size)
+{
+    size = roundup_pow_of_two(max_t(u32, size, PAGE_SIZE));
+
+    ring->buf_len = PAGE_SIZE + size;
+    ring->buf = vmalloc_user(ring->buf_len);
+    if (!ring->buf)
+        return -ENOMEM;
+
+    ring->ctrl = ring->buf;
+    ring->data = ring->buf + PAGE_SIZE;
+    ring->size = size;
+    ring->head = 0;
+    ring->ctrl->data_offset = PAGE_SIZE;
+    ring->ctrl->data_size = size;
+    return 0;
+}
+
+static void uart3_echo_ring_free(struct uart3_echo_ring *ring)
+{
+    vfree(ring->buf);
+    ring->buf = NULL;
+}
+
+/*
+ * ctrl->tail is writable from userspace through the mapping, so it is never
+ * trusted for anything but the fill level, and that is clamped to the ring.
+ */
+static u32 uart3_echo_ring_used(const struct uart3_echo_ring *ring, u32 head, u32 tail)
+{
+    return min_t(u32, head - tail, ring->size);
+}
+
+/* Record size from a header, 0 if the header cannot be one of ours. */
+static u32 uart3_echo_rec_size(const struct uart3_echo_ring *ring,
+                               const struct uart3_echo_frame_hdr *hdr)
+{
+    if (hdr->len > ring->size || hdr->flags & ~UART3_ECHO_REC_F_TIMESTAMP)
+        return 0;
+    return UART3_ECHO_REC_SIZE(hdr->len, hdr->flags);
+}
+
+/* Where the record following the one at pos starts. */
+static u32 uart3_echo_ring_next_record(const struct uart3_echo_ring *ring, u32 pos)
+{
+    u32 off = pos & (ring->size - 1);
+    u32 rec;
+
+    /* records are 8-byte aligned in a power-of-two ring: headers never wrap */
+    rec = uart3_echo_rec_size(ring, (struct uart3_echo_frame_hdr *)(ring->data + off));
+    return pos + (rec ? rec : ring->size);
+}
+
+/*
+ * Producer side; called only from receive_buf, which serdev serializes.
+ * Returns the free space once need bytes have been made room for. With
+ * overwrite set, unread data is evicted (whole records if records is set)
+ * and the evicted byte count returned in *evicted. Eviction moves tail with
+ * cmpxchg, so a consumer racing on tail either sees its own cmpxchg fail or
+ * frees the space itself.
+ */
+static u32 uart3_echo_ring_reserve(struct uart3_echo_ring *ring, u32 need,
+                                   bool overwrite, bool records, u32 *evicted)
+{
+    u32 head = ring->head;
+    u32 tail = smp_load_acquire(&ring->ctrl->tail);
+    u32 used = uart3_echo_ring_used(ring, head, tail);
+
+    *evicted = 0;
+    while (overwrite && used + need > ring->size) {
+        u32 new_tail = head + need - ring->size;
+        u32 old;
+
+        if (records) {
+            new_tail = tail;
+            while ((s32)(head - new_tail) > 0 && head - new_tail + need > ring->size)
+                new_tail = uart3_echo_ring_next_record(ring, new_tail);
+            if ((s32)(head - new_tail) < 0)
+                new_tail = head;
+        }
+
+        old = cmpxchg(&ring->ctrl->tail, tail, new_tail);
+        if (old == tail) {
+            *evicted = used - uart3_echo_ring_used(ring, head, new_tail);
+            used -= *evicted;
+            break;
+        }
+        tail = old;
+        used = uart3_echo_ring_used(ring, head, tail);
+    }
+
+    /* readers with their own cursor may still be copying from there */
+    if (!records || need <= ring->size - used) {
+        WRITE_ONCE(ring->claim, head + min_t(u32, need, ring->size - used));
+        smp_wmb(); /* claim before the data, pairs with uart3_echo_read_commit() */
+    }
+    return ring->size - used;
+}
+
+/* Copy n bytes in at head; the caller has reserved them. Not yet visible. */
+static void uart3_echo_ring_write(struct uart3_echo_ring *ring, const void *src, u32 n)
+{
+    u32 off = ring->head & (ring->size - 1);
+    u32 first = min_t(u32, n, ring->size - off);
+
+    memcpy(ring->data + off, src, first);
+    memcpy(ring->data, src + first, n - first);
+    ring->head += n;
+}
+
+static void uart3_echo_ring_publish(struct uart3_echo_ring *ring)
+{
+    /* publish the data before the new head */
+    smp_store_release(&ring->ctrl->head, ring->head);
+}
+
+static size_t uart3_echo_ring_put(struct uart3_echo_ring *ring, const u8 *buf,
+                                  size_t count, bool overwrite, u32 *evicted)
+{
+    u32 n;
+
+    if (overwrite && count > ring->size) {
+        buf += count - ring->size;
+        count = ring->size;
+    }
+
+    n = min_t(size_t, count, uart3_echo_ring_reserve(ring, count, overwrite, false, evicted));
+    uart3_echo_ring_write(ring, buf, n);
+    uart3_echo_ring_publish(ring);
+    return n;
+}
+
+/*
+ * All or nothing: a record is either stored whole or not at all. ts, if
+ * given, goes between header and payload. Returns the ring bytes used.
+ */
+static u32 uart3_echo_ring_put_record(struct uart3_echo_ring *ring, const u8 *payload, u32 len,
+                                      const struct uart3_echo_tstamp *ts,
+                                      bool overwrite, u32 *evicted)
+{
+    struct uart3_echo_frame_hdr hdr = {
+        .len = len,
+        .flags = ts ? UART3_ECHO_REC_F_TIMESTAMP : 0,
+    };
+    u32 rec = UART3_ECHO_REC_SIZE(len, hdr.flags);
+    u32 start = ring->head;
+
+    if (uart3_echo_ring_reserve(ring, rec, overwrite, true, evicted) < rec)
+        return 0;
+
+    uart3_echo_ring_write(ring, &hdr, sizeof(hdr));
+    if (ts)
+        uart3_echo_ring_write(ring, ts, sizeof(*ts));
+    uart3_echo_ring_write(ring, payload, len);
+    ring->head = start + rec; /* padding */
+    uart3_echo_ring_publish(ring);
+    return rec;
+}
+
+static u32 uart3_echo_ring_avail(const struct uart3_echo_ring *ring)
+{
+    u32 head = smp_load_acquire(&ring->ctrl->head);
+
+    return uart3_echo_ring_used(ring, head, READ_ONCE(ring->ctrl->tail));
+}
+
+/* User buffer for read(), pipe pages for splice(): same copy either way. */
+static int uart3_echo_ring_copy_to_iter(const struct uart3_echo_ring *ring, u32 pos,
+                                        struct iov_iter *to, u32 len)
+{
+    u32 off = pos & (ring->size - 1);
+    u32 first = min_t(u32, len, ring->size - off);
+
+    if (copy_to_iter(ring->data + off, first, to) != first ||
+        copy_to_iter(ring->data, len - first, to) != len - first)
+        return -EFAULT;
+    return 0;
+}
+
+/* Copy up to len bytes from position pos without consuming them. */
+static void uart3_echo_ring_peek(const struct uart3_echo_ring *ring, u32 pos, void *dst, u32 len)
+{
+    u32 off = pos & (ring->size - 1);
+    u32 first = min_t(u32, len, ring->size - off);
+
+    memcpy(dst, ring->data + off, first);
+    memcpy(dst + first, ring->data, len - first);
+}
+
+/*
+ * Queue bytes for transmission. Called from write() and from receive_buf
+ * for echo-back, both process context, so tx_lock can be a mutex.
+ */
+static unsigned int uart3_echo_tx_queue(struct uart3_echo_priv *priv, const u8 *buf, size_t count)
+{
+    unsigned int n = 0;
+
+    mutex_lock(&priv->tx_lock);
+    if (!priv->gone)
+        n = kfifo_in(&priv->tx_fifo, buf, count);
+    mutex_unlock(&priv->tx_lock);
+    if (n)
+        schedule_work(&priv->tx_work);
+    return n;
+}
+
+/*
+ * Sole consumer of tx_fifo. Hands the UART as much as it takes straight
+ * from the FIFO memory and stops at the first short write; write_wakeup
+ * reschedules us once the UART has room again.
+ */
+static void uart3_echo_tx_work(struct work_struct *work)
+{
+    struct uart3_echo_priv *priv = container_of(work, struct uart3_echo_priv, tx_work);
+    unsigned int len;
+    u8 *p;
+    int n;
+
+    /* remove() closed the port; whatever is left is dropped with priv */
+    if (READ_ONCE(priv->gone))
+        return;
+
+    while ((len = kfifo_out_linear_ptr(&priv->tx_fifo, &p, kfifo_size(&priv->tx_fifo)))) {
+        n = serdev_device_write_buf(priv->serdev, p, len);
+        trace_uart3_echo_tx(priv->miscdev.minor, len, n);
+        if (n <= 0)
+            break;
+        kfifo_skip_count(&priv->tx_fifo, n);
+        atomic64_add(n, &priv->stats.tx_bytes);
+        wake_up_interruptible_poll(&priv->write_wq, EPOLLOUT | EPOLLWRNORM);
+        if (n < len)
+            break;
+    }
+}
+
+/* RTS belongs to remove() once gone is set; it is checked under flow_lock */
+static void uart3_echo_throttle(struct uart3_echo_priv *priv, u32 level)
+{
+    if (READ_ONCE(priv->gone) || READ_ONCE(priv->throttled) ||
+        level < priv->rx.size / 4 * 3)
+        return;
+
+    mutex_lock(&priv->flow_lock);
+    if (!priv->throttled && !priv->gone) {
+        priv->throttled = true;
+        serdev_device_set_rts(priv->serdev, false);
+        atomic64_inc(&priv->stats.rx_throttled);
+        trace_uart3_echo_throttle(priv->miscdev.minor, true, level);
+    }
+    mutex_unlock(&priv->flow_lock);
+}
+
+/*
+ * Called wherever the consumer side makes progress (read, poll, poll_work;
+ * mmap consumers move tail behind our back, so the latter two matter).
+ * Also replays the backpressure stash, throttled or not.
+ */
+static void uart3_echo_unthrottle(struct uart3_echo_priv *priv)
+{
+    u32 level;
+
+    if (READ_ONCE(priv->gone))
+        return;
+    /* pairs with receive(): it stashes first, then looks at the room we made */
+    smp_mb();
+    if (READ_ONCE(priv->stash_len))
+        schedule_work(&priv->rx_kick_work);
+    if (!READ_ONCE(priv->throttled))
+        return;
+    level = uart3_echo_ring_avail(&priv->rx);
+    if (level > priv->rx.size / 4)
+        return;
+
+    mutex_lock(&priv->flow_lock);
+    if (priv->throttled && !priv->gone) {
+        priv->throttled = false;
+        serdev_device_set_rts(priv->serdev, true);
+        trace_uart3_echo_throttle(priv->miscdev.minor, false, level);
+    }
+    mutex_unlock(&priv->flow_lock);
+}
+
 static void uart3_echo_poll(struct work_struct *work)
 {
     struct uart3_echo_priv *priv =
         container_of(to_delayed_work(work), struct uart3_echo_priv, poll_work);
     struct device *dev = &priv->serdev->dev;
-    unsigned int total;
-    unsigned int preview_len;
-    unsigned char preview[32];
-
-    /* Peek into FIFO for logging without consuming user data */
-    spin_lock(&priv->fifo_lock);
-    total = kfifo_len(&priv->fifo);
-    preview_len = min_t(unsigned int, total, sizeof(preview));
-    if (preview_len)
-        preview_len = kfifo_out_peek(&priv->fifo, preview, preview_len);
-    spin_unlock(&priv->fifo_lock);
-
-    if (total) {
-        char hex[3 * 32 + 1];
-        unsigned int i, p = 0;
-        for (i = 0; i < preview_len && p + 3 < sizeof(hex); i++)
-            p += scnprintf(hex + p, sizeof(hex) - p, "%02x ", preview[i]);
-        dev_info(dev, "poll %u ms: fifo %u bytes, first %u: %s\n",
-                 priv->period_ms, total, preview_len, hex);
-    } else {
-        dev_dbg(dev, "poll %u ms: no data\n", priv->period_ms);
-    }
+
+    /* dynamic debug only; to see the data itself, open the device as a tap */
+    dev_dbg(dev, "poll %u ms: fifo %u bytes, hwm %u\n",
+            priv->period_ms, uart3_echo_ring_avail(&priv->rx),
+            READ_ONCE(priv->stats.rx_hwm));
+
+    /* Safety net for mmap consumers that never poll() */
+    uart3_echo_unthrottle(priv);
 
     /* Re-arm periodic work */
     schedule_delayed_work(&priv->poll_work, msecs_to_jiffies(priv->period_ms));
 }
 
+/* Remember when the chunk ending at ring position end arrived. */
+static void uart3_echo_mark_rx(struct uart3_echo_priv *priv, u32 end)
+{
+    u32 head = priv->rx_mark_head;
+    struct uart3_echo_rx_mark *m;
+
+    /* If nobody reads (e.g. an mmap consumer), just stop sampling */
+    if (head - smp_load_acquire(&priv->rx_mark_tail) >= UART3_ECHO_RX_MARKS)
+        return;
+
+    m = &priv->rx_marks[head % UART3_ECHO_RX_MARKS];
+    m->end = end;
+    m->ts = ktime_get();
+    smp_store_release(&priv->rx_mark_head, head + 1);
+}
+
+/* Account receive-to-read latency for every chunk fully consumed by tail. */
+static void uart3_echo_mark_read(struct uart3_echo_priv *priv, u32 tail)
+{
+    u32 mt = priv->rx_mark_tail;
+    u32 mh = smp_load_acquire(&priv->rx_mark_head);
+    ktime_t now;
+
+    if (mt == mh)
+        return;
+
+    now = ktime_get();
+    while (mt != mh) {
+        struct uart3_echo_rx_mark *m = &priv->rx_marks[mt % UART3_ECHO_RX_MARKS];
+        u64 us;
+        unsigned int b;
+
+        if ((s32)(m->end - tail) > 0)
+            break;
+        us = ktime_to_us(ktime_sub(now, m->ts));
+        b = us ? min_t(unsigned int, ilog2(us) + 1, UART3_ECHO_LAT_BUCKETS - 1) : 0;
+        atomic64_inc(&priv->stats.read_lat[b]);
+        mt++;
+    }
+    smp_store_release(&priv->rx_mark_tail, mt);
+}
+
+static void uart3_echo_dec_reset(struct uart3_echo_decoder *d)
+{
+    d->len = 0;
+    d->discard = false;
+    d->esc = false;
+    d->cobs_first = true;
+    d->cobs_code = 0;
+    d->cobs_left = 0;
+}
+
+static void uart3_echo_dec_error(struct uart3_echo_priv *priv)
+{
+    atomic64_inc(&priv->stats.rx_frame_errors);
+    priv->dec.discard = true;
+}
+
+static void uart3_echo_dec_push(struct uart3_echo_priv *priv, u8 c)
+{
+    struct uart3_echo_decoder *d = &priv->dec;
+
+    if (d->len < priv->framing.max_frame)
+        d->buf[d->len++] = c;
+    else
+        uart3_echo_dec_error(priv); /* oversized frame */
+}
+
+/*
+ * Hand a validated frame to the ring. Only under backpressure does a full
+ * ring push back (-ENOSPC); the other policies drop the frame and go on.
+ */
+static int uart3_echo_dec_emit(struct uart3_echo_priv *priv, const u8 *payload, u32 len,
+                               size_t *stored, u32 *evicted)
+{
+    bool overwrite = priv->overflow == UART3_ECHO_DROP_OLDEST;
+    const struct uart3_echo_tstamp *ts = NULL;
+    u32 ev, rec;
+
+    if (priv->framing.flags & UART3_ECHO_FRAMING_F_TIMESTAMP)
+        ts = &priv->rx_ts;
+    rec = uart3_echo_ring_put_record(&priv->rx, payload, len, ts, overwrite, &ev);
+    if (!rec) {
+        if (priv->overflow == UART3_ECHO_BACKPRESSURE)
+            return -ENOSPC;
+        atomic64_inc(&priv->stats.rx_frames_dropped);
+        return 0;
+    }
+    *stored += rec;
+    *evicted += ev;
+    atomic64_inc(&priv->stats.rx_frames);
+    return 0;
+}
+
+static bool uart3_echo_dec_crc_ok(u32 type, const u8 *p, u32 n)
+{
+    if (type == UART3_ECHO_FRAMING_LEN_CRC16)
+        return crc16(0, p, n) == get_unaligned_le16(p + n);
+    return ~crc32_le(~0, p, n) == get_unaligned_le32(p + n);
+}
+
+/*
+ * Length-prefixed frames have no delimiter to resync on: after a bad
+ * length or CRC, slide the window one byte and try again.
+ */
+static int uart3_echo_dec_lencrc(struct uart3_echo_priv *priv, size_t *stored, u32 *evicted)
+{
+    struct uart3_echo_decoder *d = &priv->dec;
+    u32 type = priv->framing.type;
+    u32 crc_len = type == UART3_ECHO_FRAMING_LEN_CRC16 ? 2 : 4;
+    u32 flen, total;
+    int ret;
+
+    while (d->len >= 2) {
+        flen = get_unaligned_le16(d->buf);
+        total = 2 + flen + crc_len;
+        if (flen && flen <= priv->framing.max_frame) {
+            if (d->len < total)
+                return 0;
+            if (uart3_echo_dec_crc_ok(type, d->buf, 2 + flen)) {
+                ret = uart3_echo_dec_emit(priv, d->buf + 2, flen, stored, evicted);
+                if (ret) {
+                    d->len--; /* give back the byte that completed it */
+                    return ret;
+                }
+                d->resync = false;
+                d->len -= total;
+                memmove(d->buf, d->buf + total, d->len);
+                continue;
+            }
+        }
+        if (!d->resync)
+            atomic64_inc(&priv->stats.rx_frame_errors);
+        d->resync = true;
+        memmove(d->buf, d->buf + 1, --d->len);
+    }
+    return 0;
+}
+
+/*
+ * Feed one byte to the decoder. Returns -ENOSPC, with the byte left
+ * unconsumed, when the frame it completes cannot be stored under
+ * backpressure.
+ */
+static int uart3_echo_dec_byte(struct uart3_echo_priv *priv, u8 c, size_t *stored, u32 *evicted)
+{
+    struct uart3_echo_decoder *d = &priv->dec;
+    int ret;
+
+    switch (priv->framing.type) {
+    case UART3_ECHO_FRAMING_SLIP:
+        if (c == SLIP_END) {
+            if (d->esc && !d->discard)
+                atomic64_inc(&priv->stats.rx_frame_errors);
+            else if (!d->discard && d->len) {
+                ret = uart3_echo_dec_emit(priv, d->buf, d->len, stored, evicted);
+                if (ret)
+                    return ret;
+            }
+            uart3_echo_dec_reset(d);
+            return 0;
+        }
+        if (d->discard)
+            return 0;
+        if (d->esc) {
+            d->esc = false;
+            if (c == SLIP_ESC_END) {
+                c = SLIP_END;
+            } else if (c == SLIP_ESC_ESC) {
+                c = SLIP_ESC;
+            } else {
+                uart3_echo_dec_error(priv);
+                return 0;
+            }
+        } else if (c == SLIP_ESC) {
+            d->esc = true;
+            return 0;
+        }
+        uart3_echo_dec_push(priv, c);
+        return 0;
+
+    case UART3_ECHO_FRAMING_COBS:
+        if (c == 0) {
+            if (d->cobs_left && !d->discard)
+                atomic64_inc(&priv->stats.rx_frame_errors); /* truncated block */
+            else if (!d->discard && d->len) {
+                ret = uart3_echo_dec_emit(priv, d->buf, d->len, stored, evicted);
+                if (ret)
+                    return ret;
+            }
+            uart3_echo_dec_reset(d);
+            return 0;
+        }
+        if (d->discard)
+            return 0;
+        if (!d->cobs_left) {
+            /* code byte: the previous block ended in an implicit zero */
+            if (!d->cobs_first && d->cobs_code != 0xFF)
+                uart3_echo_dec_push(priv, 0);
+            d->cobs_first = false;
+            d->cobs_code = c;
+            d->cobs_left = c - 1;
+            return 0;
+        }
+        d->cobs_left--;
+        uart3_echo_dec_push(priv, c);
+        return 0;
+
+    default: /* UART3_ECHO_FRAMING_LEN_CRC16 / _LEN_CRC32 */
+        d->buf[d->len++] = c;
+        return uart3_echo_dec_lencrc(priv, stored, evicted);
+    }
+}
+
+static u32 uart3_echo_reader_cursor(const struct uart3_echo_reader *r)
+{
+    return r->mapped ? READ_ONCE(r->priv->rx.ctrl->tail) : READ_ONCE(r->pos);
+}
+
+/* Bytes this reader has not seen yet. */
+static u32 uart3_echo_reader_avail(const struct uart3_echo_reader *r)
+{
+    const struct uart3_echo_ring *ring = &r->priv->rx;
+    u32 pos = uart3_echo_reader_cursor(r);
+
+    return uart3_echo_ring_used(ring, smp_load_acquire(&ring->ctrl->head), pos);
+}
+
+/* The producer is (or has been) writing over what pos still points at. */
+static bool uart3_echo_reader_lapped(const struct uart3_echo_reader *r, u32 pos)
+{
+    const struct uart3_echo_ring *ring = &r->priv->rx;
+
+    return READ_ONCE(ring->claim) - pos > ring->size;
+}
+
+static bool uart3_echo_reader_ready(const struct uart3_echo_reader *r, u32 level)
+{
+    return level && (level >= r->min_bytes || READ_ONCE(r->expired));
+}
+
+static void uart3_echo_reader_wake(struct uart3_echo_reader *r, u32 level)
+{
+    atomic64_inc(&r->priv->stats.rx_wakeups);
+    trace_uart3_echo_wakeup(r->priv->miscdev.minor, level);
+    wake_up_interruptible_poll(&r->wq, EPOLLIN | EPOLLRDNORM);
+}
+
+static enum hrtimer_restart uart3_echo_reader_timeout(struct hrtimer *timer)
+{
+    struct uart3_echo_reader *r = container_of(timer, struct uart3_echo_reader, timer);
+    u32 level = uart3_echo_reader_avail(r);
+
+    WRITE_ONCE(r->expired, true);
+    if (level)
+        uart3_echo_reader_wake(r, level);
+    return HRTIMER_NORESTART;
+}
+
+/*
+ * Called after every chunk that stored data, prev_head being where it
+ * started. Readers below their byte threshold are left asleep; for those
+ * that had seen everything before it, the chunk starts their timeout.
+ */
+static void uart3_echo_wake_readers(struct uart3_echo_priv *priv, u32 prev_head)
+{
+    struct uart3_echo_reader *r;
+    unsigned long flags;
+
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    list_for_each_entry(r, &priv->readers, node) {
+        u32 level = uart3_echo_reader_avail(r);
+
+        if ((s32)(uart3_echo_reader_cursor(r) - prev_head) >= 0) {
+            WRITE_ONCE(r->expired, false);
+            if (r->timeout_us && level < r->min_bytes)
+                hrtimer_start(&r->timer, us_to_ktime(r->timeout_us), HRTIMER_MODE_REL);
+        }
+        if (uart3_echo_reader_ready(r, level))
+            uart3_echo_reader_wake(r, level);
+    }
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+}
+
+/* Returns how many bytes of buf the decoder consumed. */
+static size_t uart3_echo_decode(struct uart3_echo_priv *priv, const u8 *buf, size_t count,
+                                size_t *stored, u32 *evicted)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+        if (uart3_echo_dec_byte(priv, buf[i], stored, evicted))
+            break;
+    return i;
+}
+
+/*
+ * Record mode without framing: one timestamped record per chunk, split at
+ * max_frame. Returns how many bytes of buf made it into the ring.
+ */
+static size_t uart3_echo_put_chunk(struct uart3_echo_priv *priv, const u8 *buf, size_t count,
+                                   size_t *stored, u32 *evicted)
+{
+    bool overwrite = priv->overflow == UART3_ECHO_DROP_OLDEST;
+    size_t done = 0;
+
+    while (done < count) {
+        u32 n = min_t(size_t, count - done, priv->framing.max_frame);
+        u32 ev, rec;
+
+        rec = uart3_echo_ring_put_record(&priv->rx, buf + done, n, &priv->rx_ts, overwrite, &ev);
+        if (!rec)
+            break;
+        *stored += rec;
+        *evicted += ev;
+        done += n;
+    }
+    return done;
+}
+
+/*
+ * Offer bytes to the framing stage or the ring; under rx_lock. Returns how
+ * many were taken: all of them, except under backpressure, where what the
+ * other policies drop (returned in *dropped) is left to the caller.
+ */
+static size_t uart3_echo_ingest(struct uart3_echo_priv *priv, const u8 *buf, size_t count,
+                                size_t *stored, u32 *evicted, size_t *dropped)
+{
+    bool overwrite = priv->overflow == UART3_ECHO_DROP_OLDEST;
+    size_t n;
+    u32 ev;
+
+    if (priv->framing.type != UART3_ECHO_FRAMING_NONE) {
+        n = uart3_echo_decode(priv, buf, count, stored, evicted);
+        atomic64_add(n, &priv->stats.rx_bytes);
+        return n;
+    }
+    if (priv->framing.flags & UART3_ECHO_FRAMING_F_TIMESTAMP) {
+        n = uart3_echo_put_chunk(priv, buf, count, stored, evicted);
+    } else {
+        n = uart3_echo_ring_put(&priv->rx, buf, count, overwrite, &ev);
+        *stored += n;
+        *evicted += ev;
+    }
+    atomic64_add(n, &priv->stats.rx_bytes);
+    if (priv->overflow == UART3_ECHO_BACKPRESSURE)
+        return n;
+    *dropped += count - n;
+    return count;
+}
+
+/* Under rx_lock: feed the backpressure stash to the ring, oldest first. */
+static void uart3_echo_stash_drain(struct uart3_echo_priv *priv, size_t *stored, u32 *evicted)
+{
+    size_t dropped = 0, n;
+
+    if (!priv->stash_len)
+        return;
+    n = uart3_echo_ingest(priv, priv->stash, priv->stash_len, stored, evicted, &dropped);
+    priv->stash_len -= n;
+    memmove(priv->stash, priv->stash + n, priv->stash_len);
+}
+
+/*
+ * Scheduled by unthrottle() when a consumer made room while bytes sat in
+ * the stash. Stashed chunks carry the timestamp of the latest chunk.
+ */
+static void uart3_echo_rx_kick(struct work_struct *work)
+{
+    struct uart3_echo_priv *priv = container_of(work, struct uart3_echo_priv, rx_kick_work);
+    size_t stored = 0;
+    u32 evicted = 0, prev_head;
+
+    mutex_lock(&priv->rx_lock);
+    prev_head = priv->rx.head;
+    uart3_echo_stash_drain(priv, &stored, &evicted);
+    if (stored)
+        uart3_echo_mark_rx(priv, priv->rx.head);
+    mutex_unlock(&priv->rx_lock);
+
+    if (stored)
+        uart3_echo_wake_readers(priv, prev_head);
+}
+
 static size_t uart3_echo_receive(struct serdev_device *serdev,
                                  const u8 *buf, size_t count)
 {
     struct uart3_echo_priv *priv = serdev_device_get_drvdata(serdev);
-
-    dev_info(&serdev->dev, "rx %zu bytes\n", count);
+    size_t in = count;
 
     if (priv && count) {
-        unsigned int in = kfifo_in_spinlocked(&priv->fifo, buf, count, &priv->fifo_lock);
-        if (in < count)
-            dev_warn(&serdev->dev, "fifo overflow: dropped %zu bytes\n", count - in);
-        /* wake up any blocking readers */
-        if (in)
-            wake_up_interruptible(&priv->read_wq);
+        int minor = priv->miscdev.minor;
+        bool backpressure = priv->overflow == UART3_ECHO_BACKPRESSURE;
+        u32 evicted = 0, level, stashed;
+        size_t stored = 0, dropped = 0;
+        u32 prev_head;
+
+        mutex_lock(&priv->rx_lock);
+        prev_head = priv->rx.head;
+        if (priv->framing.flags & UART3_ECHO_FRAMING_F_TIMESTAMP) {
+            /* one clock read per chunk; boottime is derived from it */
+            ktime_t now = ktime_get();
+
+            priv->rx_ts.mono_ns = ktime_to_ns(now);
+            priv->rx_ts.boot_ns = ktime_to_ns(ktime_mono_to_any(now, TK_OFFS_BOOT));
+        }
+        /* stashed bytes go first, and new ones queue behind them */
+        uart3_echo_stash_drain(priv, &stored, &evicted);
+        in = 0;
+        if (!priv->stash_len)
+            in = uart3_echo_ingest(priv, buf, count, &stored, &evicted, &dropped);
+        if (in < count) {
+            /* backpressure only; a full stash is left to the tty buffer */
+            size_t n = min_t(size_t, count - in, UART3_ECHO_STASH_SIZE - priv->stash_len);
+
+            memcpy(priv->stash + priv->stash_len, buf + in, n);
+            priv->stash_len += n;
+            in += n;
+        }
+        stashed = priv->stash_len;
+        dropped += evicted;
+        level = uart3_echo_ring_avail(&priv->rx);
+        if (stored)
+            uart3_echo_mark_rx(priv, priv->rx.head);
+        mutex_unlock(&priv->rx_lock);
+
+        trace_uart3_echo_rx(minor, count, in, level);
+        if (level > priv->stats.rx_hwm)
+            WRITE_ONCE(priv->stats.rx_hwm, level);
+
+        if (backpressure) {
+            /*
+             * Lossless up to the stash: dropping RTS at 3/4 full leaves
+             * the ring's last quarter plus the stash for what the peer
+             * and the UART FIFO still had in flight. Without RTS/CTS a
+             * full stash makes us return short, and the tty layer only
+             * offers that remainder again once more data arrives.
+             */
+            if (stashed) {
+                atomic64_inc(&priv->stats.rx_stalls);
+                /* pairs with unthrottle(): room made before it saw the stash */
+                smp_mb();
+                if (uart3_echo_ring_avail(&priv->rx) < level)
+                    schedule_work(&priv->rx_kick_work);
+            }
+            if (priv->flow_control)
+                uart3_echo_throttle(priv, level);
+        } else if (dropped) {
+            trace_uart3_echo_overflow(minor, dropped, level);
+            atomic64_add(dropped, &priv->stats.rx_dropped);
+        }
+
+        if (stored)
+            uart3_echo_wake_readers(priv, prev_head);
     }
 
-    if (priv && priv->echo_back && count) {
-        int n = serdev_device_write_buf(serdev, buf, count);
-        dev_info(&serdev->dev, "echoed %d bytes\n", n);
+    /* Only echo what was consumed; the rest will be delivered again */
+    if (priv && priv->echo_back && in) {
+        unsigned int n = uart3_echo_tx_queue(priv, buf, in);
+
+        if (n < in)
+            atomic64_add(in - n, &priv->stats.tx_dropped);
     }
-    return count; // consumed all bytes
+    return in;
 }
 
+/* May run in the UART's IRQ path with the port lock held: never write here */
 static void uart3_echo_write_wakeup(struct serdev_device *serdev)
 {
-    // Nothing to do; required by serdev ops signature
+    struct uart3_echo_priv *priv = serdev_device_get_drvdata(serdev);
+
+    if (priv)
+        schedule_work(&priv->tx_work);
 }
 
 static const struct serdev_device_ops uart3_echo_ops = {
@@ -98,104 +1017,780 @@ static const struct serdev_device_ops uart3_echo_ops = {
 };
 
 /*
- * Character device: /dev/uart3_echo
- * - read(): drains from FIFO to userspace
- * - poll(): signals readable when FIFO has data
- * - write(): sends bytes to underlying serdev (optional)
+ * Character device: /dev/<name> (e.g. /dev/uart3_echo)
+ * - read(): drains from the RX ring to userspace; blocking reads wait for
+ *   the per-file wakeup threshold (UART3_ECHO_IOC_SET_WAKEUP)
+ * - splice()/sendfile(): same paths as read()/write(), via pipe pages
+ * - mmap(): maps the RX ring itself (control page + data, see uart3_echo.h)
+ * - poll(): signals readable under the same threshold as read()
+ * - write(): queues bytes on the TX FIFO for the underlying serdev
+ * - fsync(): waits until the TX FIFO and the UART have drained
  */
 
-static ssize_t uart3_echo_chr_read(struct file *filp, char __user *ubuf,
-                                   size_t len, loff_t *ppos)
+static struct uart3_echo_priv *uart3_echo_file_priv(struct file *filp)
 {
-    struct uart3_echo_priv *priv = container_of(filp->private_data, struct uart3_echo_priv, miscdev);
-    size_t want;
-    unsigned int copied;
-    unsigned char *kbuf;
-    int ret;
+    struct uart3_echo_reader *r = filp->private_data;
 
-    if (len == 0)
-        return 0;
+    return r->priv;
+}
 
-    /* Blocking behavior: wait for data if FIFO empty */
-    if (kfifo_is_empty(&priv->fifo)) {
-        if (filp->f_flags & O_NONBLOCK)
-            return -EAGAIN;
-        ret = wait_event_interruptible(priv->read_wq, !kfifo_is_empty(&priv->fifo));
-        if (ret)
-            return ret;
+/*
+ * Consumers hold tail back to the slowest of them, unless a mapping owns it.
+ * Never moves tail backwards: drop-oldest eviction may be ahead of us.
+ */
+static void uart3_echo_advance_tail(struct uart3_echo_priv *priv)
+{
+    struct uart3_echo_ring *ring = &priv->rx;
+    u32 head = smp_load_acquire(&ring->ctrl->head);
+    struct uart3_echo_reader *r;
+    u32 lag = 0, tail, old;
+    bool any = false;
+
+    lockdep_assert_held(&priv->readers_lock);
+    if (priv->mappers)
+        return;
+
+    list_for_each_entry(r, &priv->readers, node) {
+        if (r->flags & UART3_ECHO_READER_F_TAP)
+            continue;
+        if (!any || head - r->pos > lag)
+            lag = head - r->pos;
+        any = true;
     }
+    if (!any)
+        return;
 
-    /* Limit a single read chunk to reasonable size */
-    want = min_t(size_t, len, 4096);
-    kbuf = kmalloc(want, GFP_KERNEL);
-    if (!kbuf)
-        return -ENOMEM;
+    tail = READ_ONCE(ring->ctrl->tail);
+    while ((s32)(head - lag - tail) > 0) {
+        old = cmpxchg(&ring->ctrl->tail, tail, head - lag);
+        if (old == tail) {
+            uart3_echo_mark_read(priv, head - lag);
+            break;
+        }
+        tail = old;
+    }
+}
 
-    spin_lock(&priv->fifo_lock);
-    copied = kfifo_out(&priv->fifo, kbuf, want);
-    spin_unlock(&priv->fifo_lock);
+/*
+ * Where this reader's next read starts. A cursor the producer has lapped
+ * restarts at tail, the oldest unconsumed byte and always a record
+ * boundary, and the reader gets an overrun.
+ */
+static u32 uart3_echo_read_begin(struct uart3_echo_reader *r)
+{
+    struct uart3_echo_priv *priv = r->priv;
+    struct uart3_echo_ring *ring = &priv->rx;
+    unsigned long flags;
+    u32 pos, tail;
 
-    if (!copied) {
-        kfree(kbuf);
-        return 0;
+    if (r->mapped)
+        return READ_ONCE(ring->ctrl->tail);
+
+    pos = r->pos;
+    if (!uart3_echo_reader_lapped(r, pos))
+        return pos;
+
+    tail = READ_ONCE(ring->ctrl->tail);
+    if (uart3_echo_reader_lapped(r, tail))
+        tail = smp_load_acquire(&ring->ctrl->head); /* tail scribbled on via mmap */
+
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    r->pos = tail;
+    r->overruns++;
+    r->lost_bytes += tail - pos;
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+    atomic64_inc(&priv->stats.rx_overruns);
+    return tail;
+}
+
+/*
+ * Finish a read that copied [pos, end). Returns false if that data may have
+ * been overwritten meanwhile; the caller then starts over, overwriting what
+ * it already put in the user buffer. A mapped reader detects that by its
+ * cmpxchg on tail failing, the others by the producer's claim having passed
+ * pos + size: claim is written before the data and read after the copy.
+ */
+static bool uart3_echo_read_commit(struct uart3_echo_reader *r, u32 pos, u32 end)
+{
+    struct uart3_echo_priv *priv = r->priv;
+    unsigned long flags;
+
+    if (r->mapped) {
+        if (cmpxchg(&priv->rx.ctrl->tail, pos, end) != pos)
+            return false;
+        spin_lock_irqsave(&priv->readers_lock, flags);
+        uart3_echo_mark_read(priv, end);
+        spin_unlock_irqrestore(&priv->readers_lock, flags);
+        return true;
     }
-    if (copy_to_user(ubuf, kbuf, copied)) {
-        kfree(kbuf);
-        return -EFAULT;
+
+    smp_rmb();
+    if (uart3_echo_reader_lapped(r, pos))
+        return false;
+
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    r->pos = end;
+    uart3_echo_advance_tail(priv);
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+    return true;
+}
+
+/*
+ * Raw byte stream. Copies straight out of the ring into the iter; no bounce
+ * buffer, no per-call cap. A retry rewinds the iter over the stale copy.
+ */
+static ssize_t uart3_echo_read_bytes(struct uart3_echo_reader *r, struct iov_iter *to)
+{
+    struct uart3_echo_ring *ring = &r->priv->rx;
+    u32 head, pos, n;
+
+    for (;;) {
+        pos = uart3_echo_read_begin(r);
+        head = smp_load_acquire(&ring->ctrl->head);
+        n = min_t(size_t, iov_iter_count(to), uart3_echo_ring_used(ring, head, pos));
+        if (uart3_echo_ring_copy_to_iter(ring, pos, to, n))
+            return -EFAULT;
+        if (uart3_echo_read_commit(r, pos, pos + n))
+            return n;
+        iov_iter_revert(to, n);
     }
-    kfree(kbuf);
-    return copied;
+}
+
+/*
+ * The header at start is not a record: skip to the next 8-byte boundary
+ * that holds one (or to head) and charge the gap to this reader as lost.
+ * Returns true if the caller should read again from there, false if
+ * nothing valid was left.
+ */
+static bool uart3_echo_resync(struct uart3_echo_reader *r, u32 start, u32 head)
+{
+    struct uart3_echo_priv *priv = r->priv;
+    struct uart3_echo_ring *ring = &priv->rx;
+    struct uart3_echo_frame_hdr hdr;
+    unsigned long flags;
+    u32 pos = start, rec;
+
+    do {
+        pos = ALIGN(pos + 1, UART3_ECHO_FRAME_ALIGN);
+        if (pos == head)
+            break;
+        uart3_echo_ring_peek(ring, pos, &hdr, sizeof(hdr));
+        rec = uart3_echo_rec_size(ring, &hdr);
+    } while (!rec || rec > head - pos);
+
+    if (!uart3_echo_read_commit(r, start, pos))
+        return true; /* overwritten under us, header is stale */
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    r->lost_bytes += pos - start;
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+    atomic64_inc(&priv->stats.rx_resyncs);
+    return pos != head;
+}
+
+/*
+ * Records: one frame payload per call, or in record mode (timestamps) one
+ * whole record; whole records, as many as fit, in batch mode.
+ */
+static ssize_t uart3_echo_read_frames(struct uart3_echo_reader *r, struct iov_iter *to)
+{
+    struct uart3_echo_priv *priv = r->priv;
+    struct uart3_echo_ring *ring = &priv->rx;
+    bool batch = priv->framing.flags & UART3_ECHO_FRAMING_F_BATCH;
+    bool whole = priv->framing.flags & UART3_ECHO_FRAMING_F_TIMESTAMP;
+    size_t len = iov_iter_count(to);
+    struct uart3_echo_frame_hdr hdr;
+    u32 head, start, pos, rec;
+    size_t done = 0;
+
+retry:
+    iov_iter_revert(to, done);
+    start = uart3_echo_read_begin(r);
+    head = smp_load_acquire(&ring->ctrl->head);
+    done = 0;
+    for (pos = start; pos != head; pos += rec) {
+        uart3_echo_ring_peek(ring, pos, &hdr, sizeof(hdr));
+        rec = uart3_echo_rec_size(ring, &hdr);
+        if (!rec || rec > head - pos) {
+            if (pos != start)
+                break; /* hand out what we have, resync on the next call */
+            if (uart3_echo_resync(r, start, head))
+                goto retry; /* found a record, or the header was stale */
+            /* not on a record boundary; only an mmap user does that */
+            return -EIO;
+        }
+
+        if (!batch) {
+            u32 off = whole ? 0 : UART3_ECHO_REC_PAYLOAD_OFFSET(hdr.flags);
+            u32 n = whole ? rec : hdr.len;
+
+            if (n > len)
+                return -EMSGSIZE;
+            if (uart3_echo_ring_copy_to_iter(ring, pos + off, to, n))
+                return -EFAULT;
+            done = n;
+            pos += rec;
+            break;
+        }
+
+        if (done + rec > len)
+            break;
+        if (uart3_echo_ring_copy_to_iter(ring, pos, to, rec))
+            return -EFAULT;
+        done += rec;
+    }
+    if (pos == start)
+        return -EMSGSIZE; /* not even one record fits */
+    if (!uart3_echo_read_commit(r, start, pos))
+        goto retry;
+
+    return done;
+}
+
+/*
+ * read() and, through copy_splice_read(), splice()/sendfile() from the
+ * device: the latter land straight in pipe pages, no userspace round trip.
+ */
+static ssize_t uart3_echo_chr_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+    struct file *filp = iocb->ki_filp;
+    struct uart3_echo_reader *r = filp->private_data;
+    struct uart3_echo_priv *priv = r->priv;
+    bool nonblock = filp->f_flags & O_NONBLOCK || iocb->ki_flags & IOCB_NOWAIT;
+    ssize_t ret;
+
+    if (!iov_iter_count(to))
+        return 0;
+
+    ret = mutex_lock_interruptible(&r->lock);
+    if (ret)
+        return ret;
+
+    for (;;) {
+        /*
+         * Blocking reads wait for this reader's wakeup threshold, O_NONBLOCK
+         * for any data. Once the UART is gone, drain what is left, then EOF.
+         */
+        if (nonblock || READ_ONCE(priv->gone) ?
+            uart3_echo_reader_avail(r) : uart3_echo_reader_ready(r, uart3_echo_reader_avail(r))) {
+            ret = down_read_interruptible(&priv->read_lock);
+            if (ret)
+                break;
+            /* set_framing() may have flushed the ring while we waited */
+            if (uart3_echo_reader_avail(r)) {
+                if (priv->framing.type == UART3_ECHO_FRAMING_NONE &&
+                    !(priv->framing.flags & UART3_ECHO_FRAMING_F_TIMESTAMP))
+                    ret = uart3_echo_read_bytes(r, to);
+                else
+                    ret = uart3_echo_read_frames(r, to);
+                up_read(&priv->read_lock);
+                break;
+            }
+            up_read(&priv->read_lock);
+        }
+        if (READ_ONCE(priv->gone)) {
+            ret = 0;
+            break;
+        }
+        if (nonblock) {
+            ret = -EAGAIN;
+            break;
+        }
+        ret = wait_event_interruptible(r->wq,
+                                       uart3_echo_reader_ready(r, uart3_echo_reader_avail(r)) ||
+                                       READ_ONCE(priv->gone));
+        if (ret)
+            break;
+    }
+    mutex_unlock(&r->lock);
+
+    if (ret > 0)
+        uart3_echo_unthrottle(priv);
+    return ret;
 }
 
 static __poll_t uart3_echo_chr_poll(struct file *filp, poll_table *wait)
 {
-    struct uart3_echo_priv *priv = container_of(filp->private_data, struct uart3_echo_priv, miscdev);
+    struct uart3_echo_reader *r = filp->private_data;
+    struct uart3_echo_priv *priv = r->priv;
     __poll_t mask = 0;
 
-    poll_wait(filp, &priv->read_wq, wait);
-    if (!kfifo_is_empty(&priv->fifo))
-        mask |= POLLIN | POLLRDNORM;
+    poll_wait(filp, &r->wq, wait);
+    poll_wait(filp, &priv->write_wq, wait);
+    uart3_echo_unthrottle(priv);
+    if (READ_ONCE(priv->gone))
+        return EPOLLHUP | (uart3_echo_reader_avail(r) ? EPOLLIN | EPOLLRDNORM : 0);
+    if (uart3_echo_reader_ready(r, uart3_echo_reader_avail(r)))
+        mask |= EPOLLIN | EPOLLRDNORM;
+    /* lapped, or lapped earlier and not yet collected with GET_READER */
+    if (READ_ONCE(r->overruns) || (!r->mapped && uart3_echo_reader_lapped(r, READ_ONCE(r->pos))))
+        mask |= EPOLLPRI;
+    if (!kfifo_is_full(&priv->tx_fifo))
+        mask |= EPOLLOUT | EPOLLWRNORM;
     return mask;
 }
 
-static ssize_t uart3_echo_chr_write(struct file *filp, const char __user *ubuf,
-                                    size_t len, loff_t *ppos)
+/*
+ * kfifo_from_user() for any iov_iter: copy straight into the FIFO's free
+ * space (at most two segments), so splice_write pipe pages are not bounced.
+ * Caller holds tx_lock.
+ */
+static size_t uart3_echo_tx_from_iter(struct uart3_echo_priv *priv, struct iov_iter *from)
 {
-    struct uart3_echo_priv *priv = container_of(filp->private_data, struct uart3_echo_priv, miscdev);
-    unsigned char *kbuf;
-    int n;
+    struct scatterlist sg[2];
+    unsigned int nents, i;
+    size_t copied = 0;
 
-    if (len == 0)
-        return 0;
-    if (len > 4096)
-        len = 4096;
+    sg_init_table(sg, ARRAY_SIZE(sg));
+    nents = kfifo_dma_in_prepare(&priv->tx_fifo, sg, ARRAY_SIZE(sg), iov_iter_count(from));
+    for (i = 0; i < nents; i++) {
+        size_t n = copy_from_iter(sg_virt(&sg[i]), sg[i].length, from);
 
-    kbuf = memdup_user(ubuf, len);
-    if (IS_ERR(kbuf))
-        return PTR_ERR(kbuf);
+        copied += n;
+        if (n < sg[i].length)
+            break;
+    }
+    kfifo_dma_in_finish(&priv->tx_fifo, copied);
+    return copied;
+}
 
-    n = serdev_device_write_buf(priv->serdev, kbuf, len);
-    kfree(kbuf);
-    if (n < 0)
-        return n;
-    return n;
+/* write() and, through iter_file_splice_write(), splice()/sendfile() to the device */
+static ssize_t uart3_echo_chr_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+    struct file *filp = iocb->ki_filp;
+    struct uart3_echo_priv *priv = uart3_echo_file_priv(filp);
+    bool nonblock = filp->f_flags & O_NONBLOCK || iocb->ki_flags & IOCB_NOWAIT;
+    size_t done = 0;
+    size_t copied;
+    int ret;
+
+    /* Blocking writers loop until everything is queued; no UART retries here */
+    while (iov_iter_count(from)) {
+        if (kfifo_is_full(&priv->tx_fifo)) {
+            if (done)
+                schedule_work(&priv->tx_work);
+            if (nonblock)
+                return done ? done : -EAGAIN;
+            ret = wait_event_interruptible(priv->write_wq, !kfifo_is_full(&priv->tx_fifo) ||
+                                           READ_ONCE(priv->gone));
+            if (ret)
+                return done ? done : ret;
+        }
+
+        ret = mutex_lock_interruptible(&priv->tx_lock);
+        if (ret)
+            return done ? done : ret;
+        if (priv->gone) {
+            mutex_unlock(&priv->tx_lock);
+            return done ? done : -ENODEV;
+        }
+        copied = uart3_echo_tx_from_iter(priv, from);
+        mutex_unlock(&priv->tx_lock);
+        done += copied;
+        if (!copied && !kfifo_is_full(&priv->tx_fifo))
+            return done ? done : -EFAULT;
+    }
+
+    if (done)
+        schedule_work(&priv->tx_work);
+    return done;
+}
+
+static int uart3_echo_chr_fsync(struct file *filp, loff_t start, loff_t end, int datasync)
+{
+    struct uart3_echo_priv *priv = uart3_echo_file_priv(filp);
+    int ret;
+
+    ret = wait_event_interruptible(priv->write_wq, kfifo_is_empty(&priv->tx_fifo) ||
+                                   READ_ONCE(priv->gone));
+    if (ret)
+        return ret;
+    if (READ_ONCE(priv->gone))
+        return -ENODEV;
+    serdev_device_wait_until_sent(priv->serdev, 0);
+    return 0;
+}
+
+/*
+ * Switch framing. Everything buffered (ring and decoder) is discarded, as
+ * its format changes; read_lock keeps readers out while rx_lock keeps
+ * receive_buf out.
+ */
+static int uart3_echo_set_framing(struct uart3_echo_priv *priv, const struct uart3_echo_framing *f)
+{
+    u32 max_frame = f->max_frame ? f->max_frame : priv->framing.max_frame;
+    u32 rec_flags = f->flags & UART3_ECHO_FRAMING_F_TIMESTAMP ? UART3_ECHO_REC_F_TIMESTAMP : 0;
+    struct uart3_echo_reader *r;
+    unsigned long flags;
+    u8 *buf, *old;
+
+    if (f->type >= ARRAY_SIZE(uart3_echo_framing_names) ||
+        f->flags & ~(UART3_ECHO_FRAMING_F_BATCH | UART3_ECHO_FRAMING_F_TIMESTAMP))
+        return -EINVAL;
+    if (!max_frame || max_frame > U16_MAX ||
+        UART3_ECHO_REC_SIZE(max_frame, rec_flags) > priv->rx.size)
+        return -EINVAL;
+
+    /* room for the length-prefixed header and CRC32 around the payload */
+    buf = kmalloc(max_frame + 6, GFP_KERNEL);
+    if (!buf)
+        return -ENOMEM;
+
+    down_write(&priv->read_lock);
+    mutex_lock(&priv->rx_lock);
+    old = priv->dec.buf;
+    priv->dec.buf = buf;
+    priv->dec.resync = false;
+    uart3_echo_dec_reset(&priv->dec);
+    atomic64_add(priv->stash_len, &priv->stats.rx_dropped);
+    priv->stash_len = 0;
+    priv->framing.type = f->type;
+    priv->framing.flags = f->flags;
+    priv->framing.max_frame = max_frame;
+    /* records must start 8-byte aligned so their headers never wrap */
+    priv->rx.head = ALIGN(priv->rx.head, UART3_ECHO_FRAME_ALIGN);
+    priv->rx.claim = priv->rx.head;
+    uart3_echo_ring_publish(&priv->rx);
+    smp_store_release(&priv->rx.ctrl->tail, priv->rx.head);
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    list_for_each_entry(r, &priv->readers, node)
+        r->pos = priv->rx.head;
+    uart3_echo_mark_read(priv, priv->rx.head);
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+    mutex_unlock(&priv->rx_lock);
+    up_write(&priv->read_lock);
+
+    kfree(old);
+    uart3_echo_unthrottle(priv);
+    return 0;
+}
+
+static int uart3_echo_set_wakeup(struct uart3_echo_reader *r, const struct uart3_echo_wakeup *w)
+{
+    struct uart3_echo_priv *priv = r->priv;
+    unsigned long flags;
+    u32 level;
+
+    if (w->min_bytes > priv->rx.size)
+        return -EINVAL;
+
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    r->min_bytes = max_t(u32, w->min_bytes, 1);
+    r->timeout_us = w->timeout_us;
+    level = uart3_echo_reader_avail(r);
+    if (!r->timeout_us)
+        hrtimer_try_to_cancel(&r->timer);
+    else if (level && !r->expired && !hrtimer_active(&r->timer))
+        hrtimer_start(&r->timer, us_to_ktime(r->timeout_us), HRTIMER_MODE_REL);
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+
+    /* a lower threshold may already be met */
+    if (uart3_echo_reader_ready(r, level))
+        uart3_echo_reader_wake(r, level);
+    return 0;
+}
+
+static struct uart3_echo_wakeup uart3_echo_get_wakeup(struct uart3_echo_reader *r)
+{
+    struct uart3_echo_wakeup w;
+    unsigned long flags;
+
+    spin_lock_irqsave(&r->priv->readers_lock, flags);
+    w.min_bytes = r->min_bytes;
+    w.timeout_us = r->timeout_us;
+    spin_unlock_irqrestore(&r->priv->readers_lock, flags);
+    return w;
+}
+
+static int uart3_echo_set_reader(struct uart3_echo_reader *r, const struct uart3_echo_reader_info *info)
+{
+    struct uart3_echo_priv *priv = r->priv;
+    unsigned long flags;
+
+    if (info->flags & ~UART3_ECHO_READER_F_TAP)
+        return -EINVAL;
+
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    r->flags = info->flags;
+    uart3_echo_advance_tail(priv); /* a consumer turned tap no longer holds tail */
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+    uart3_echo_unthrottle(priv);
+    return 0;
+}
+
+/* Collects (and clears) the overrun counters. */
+static struct uart3_echo_reader_info uart3_echo_get_reader(struct uart3_echo_reader *r)
+{
+    struct uart3_echo_reader_info info = { 0 };
+    unsigned long flags;
+
+    spin_lock_irqsave(&r->priv->readers_lock, flags);
+    info.flags = r->flags;
+    info.overruns = r->overruns;
+    info.lost_bytes = r->lost_bytes;
+    r->overruns = 0;
+    r->lost_bytes = 0;
+    spin_unlock_irqrestore(&r->priv->readers_lock, flags);
+    return info;
+}
+
+static long uart3_echo_chr_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+    struct uart3_echo_priv *priv = uart3_echo_file_priv(filp);
+    void __user *uarg = (void __user *)arg;
+    struct uart3_echo_framing f;
+    struct uart3_echo_wakeup w;
+    struct uart3_echo_reader_info info;
+
+    if (READ_ONCE(priv->gone))
+        return -ENODEV;
+
+    switch (cmd) {
+    case UART3_ECHO_IOC_SET_FRAMING:
+        if (copy_from_user(&f, uarg, sizeof(f)))
+            return -EFAULT;
+        return uart3_echo_set_framing(priv, &f);
+    case UART3_ECHO_IOC_GET_FRAMING:
+        mutex_lock(&priv->rx_lock);
+        f = priv->framing;
+        mutex_unlock(&priv->rx_lock);
+        return copy_to_user(uarg, &f, sizeof(f)) ? -EFAULT : 0;
+    case UART3_ECHO_IOC_SET_WAKEUP:
+        if (copy_from_user(&w, uarg, sizeof(w)))
+            return -EFAULT;
+        return uart3_echo_set_wakeup(filp->private_data, &w);
+    case UART3_ECHO_IOC_GET_WAKEUP:
+        w = uart3_echo_get_wakeup(filp->private_data);
+        return copy_to_user(uarg, &w, sizeof(w)) ? -EFAULT : 0;
+    case UART3_ECHO_IOC_SET_READER:
+        if (copy_from_user(&info, uarg, sizeof(info)))
+            return -EFAULT;
+        return uart3_echo_set_reader(filp->private_data, &info);
+    case UART3_ECHO_IOC_GET_READER:
+        info = uart3_echo_get_reader(filp->private_data);
+        return copy_to_user(uarg, &info, sizeof(info)) ? -EFAULT : 0;
+    default:
+        return -ENOTTY;
+    }
+}
+
+/*
+ * Map the RX ring. The control page may be mapped writable (the consumer
+ * owns tail); the data pages are read-only so the kernel never has to
+ * distrust what it reads back from them. From here on this file consumes
+ * through ctrl->tail, and read() consumers on other files stop moving it.
+ */
+static int uart3_echo_chr_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+    struct uart3_echo_reader *r = filp->private_data;
+    struct uart3_echo_priv *priv = r->priv;
+    unsigned long nr_pages = priv->rx.buf_len >> PAGE_SHIFT;
+    unsigned long flags;
+    int ret;
+
+    if (vma->vm_pgoff >= nr_pages || vma_pages(vma) > nr_pages - vma->vm_pgoff)
+        return -EINVAL;
+
+    if (vma->vm_pgoff + vma_pages(vma) > 1) {
+        if (vma->vm_flags & VM_WRITE)
+            return -EPERM;
+        vm_flags_clear(vma, VM_MAYWRITE);
+    }
+
+    ret = remap_vmalloc_range(vma, priv->rx.buf, vma->vm_pgoff);
+    if (ret)
+        return ret;
+
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    if (!r->mapped) {
+        r->mapped = true;
+        priv->mappers++;
+    }
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+    return 0;
 }
 
 static int uart3_echo_chr_open(struct inode *inode, struct file *filp)
 {
-    /* nothing to do; miscdevice->this_device is already set */
+    /* misc_open() left the miscdevice in private_data; swap in a reader */
+    struct uart3_echo_priv *priv = container_of(filp->private_data, struct uart3_echo_priv, miscdev);
+    struct uart3_echo_reader *r;
+    unsigned long flags;
+
+    r = kzalloc(sizeof(*r), GFP_KERNEL);
+    if (!r)
+        return -ENOMEM;
+
+    kref_get(&priv->ref); /* misc_deregister() waits for us, priv is live */
+    r->priv = priv;
+    mutex_init(&r->lock);
+    init_waitqueue_head(&r->wq);
+    hrtimer_setup(&r->timer, uart3_echo_reader_timeout, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    r->min_bytes = max_t(u32, priv->wakeup.min_bytes, 1);
+    r->timeout_us = priv->wakeup.timeout_us;
+    /* start at the oldest unconsumed byte, like the other consumers */
+    r->pos = READ_ONCE(priv->rx.ctrl->tail);
+    /* data already waiting counts as unread from now on */
+    if (r->timeout_us && uart3_echo_reader_avail(r))
+        hrtimer_start(&r->timer, us_to_ktime(r->timeout_us), HRTIMER_MODE_REL);
+    list_add_tail(&r->node, &priv->readers);
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+
+    filp->private_data = r;
+    return 0;
+}
+
+static void uart3_echo_priv_release(struct kref *ref)
+{
+    struct uart3_echo_priv *priv = container_of(ref, struct uart3_echo_priv, ref);
+
+    /* a write() racing remove() may have requeued it */
+    cancel_work_sync(&priv->tx_work);
+    cancel_work_sync(&priv->rx_kick_work);
+    kfifo_free(&priv->tx_fifo);
+    kfree(priv->stash);
+    kfree(priv->dec.buf);
+    uart3_echo_ring_free(&priv->rx);
+    kfree(priv);
+}
+
+static int uart3_echo_chr_release(struct inode *inode, struct file *filp)
+{
+    struct uart3_echo_reader *r = filp->private_data;
+    struct uart3_echo_priv *priv = r->priv;
+    unsigned long flags;
+
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    list_del(&r->node);
+    if (r->mapped)
+        priv->mappers--;
+    /* it may have been the slowest consumer */
+    uart3_echo_advance_tail(priv);
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+    hrtimer_cancel(&r->timer);
+    uart3_echo_unthrottle(priv);
+    kfree(r);
+    kref_put(&priv->ref, uart3_echo_priv_release);
     return 0;
 }
 
 static const struct file_operations uart3_echo_fops = {
     .owner = THIS_MODULE,
-    .read = uart3_echo_chr_read,
-    .write = uart3_echo_chr_write,
+    .read_iter = uart3_echo_chr_read_iter,
+    .write_iter = uart3_echo_chr_write_iter,
+    .splice_read = copy_splice_read,
+    .splice_write = iter_file_splice_write,
+    .fsync = uart3_echo_chr_fsync,
+    .unlocked_ioctl = uart3_echo_chr_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
     .poll = uart3_echo_chr_poll,
+    .mmap = uart3_echo_chr_mmap,
     .open = uart3_echo_chr_open,
+    .release = uart3_echo_chr_release,
     .llseek = noop_llseek,
 };
 
+static int uart3_echo_stats_show(struct seq_file *m, void *v)
+{
+    struct uart3_echo_priv *priv = m->private;
+    struct uart3_echo_stats *st = &priv->stats;
+    struct uart3_echo_reader *r;
+    unsigned long flags;
+    unsigned int i;
+
+    seq_printf(m, "rx_bytes:   %llu\n", (u64)atomic64_read(&st->rx_bytes));
+    seq_printf(m, "rx_dropped: %llu\n", (u64)atomic64_read(&st->rx_dropped));
+    seq_printf(m, "tx_bytes:   %llu\n", (u64)atomic64_read(&st->tx_bytes));
+    seq_printf(m, "tx_dropped: %llu\n", (u64)atomic64_read(&st->tx_dropped));
+    seq_printf(m, "rx_stalls:  %llu (stash %u / %lu)\n", (u64)atomic64_read(&st->rx_stalls),
+               READ_ONCE(priv->stash_len), UART3_ECHO_STASH_SIZE);
+    seq_printf(m, "throttled:  %llu (now %d)\n", (u64)atomic64_read(&st->rx_throttled),
+               READ_ONCE(priv->throttled));
+    seq_printf(m, "overflow:   %s\n", uart3_echo_overflow_names[priv->overflow]);
+    seq_printf(m, "framing:    %s (max %u)%s\n", uart3_echo_framing_names[priv->framing.type],
+               priv->framing.max_frame,
+               priv->framing.flags & UART3_ECHO_FRAMING_F_TIMESTAMP ? " timestamped" : "");
+    seq_printf(m, "rx_frames:  %llu\n", (u64)atomic64_read(&st->rx_frames));
+    seq_printf(m, "rx_frame_errors:  %llu\n", (u64)atomic64_read(&st->rx_frame_errors));
+    seq_printf(m, "rx_frames_dropped: %llu\n", (u64)atomic64_read(&st->rx_frames_dropped));
+    seq_printf(m, "rx_wakeups: %llu\n", (u64)atomic64_read(&st->rx_wakeups));
+    seq_printf(m, "rx_overruns: %llu\n", (u64)atomic64_read(&st->rx_overruns));
+    seq_printf(m, "rx_resyncs: %llu\n", (u64)atomic64_read(&st->rx_resyncs));
+    seq_printf(m, "rx_level:   %u\n", uart3_echo_ring_avail(&priv->rx));
+    seq_printf(m, "rx_hwm:     %u / %u\n", READ_ONCE(st->rx_hwm), priv->rx.size);
+
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    list_for_each_entry(r, &priv->readers, node)
+        seq_printf(m, "reader:     %s lag %u overruns %u\n",
+                   r->mapped ? "mmap" : r->flags & UART3_ECHO_READER_F_TAP ? "tap" : "consumer",
+                   uart3_echo_reader_avail(r), r->overruns);
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+
+    seq_puts(m, "read latency (receive_buf -> consumed):\n");
+    for (i = 0; i < UART3_ECHO_LAT_BUCKETS; i++) {
+        u64 cnt = atomic64_read(&st->read_lat[i]);
+
+        if (i == 0)
+            seq_printf(m, "  %10s %llu\n", "<1us", cnt);
+        else if (i == UART3_ECHO_LAT_BUCKETS - 1)
+            seq_printf(m, "  >=%7uus %llu\n", 1U << (i - 1), cnt);
+        else
+            seq_printf(m, "  <%8uus %llu\n", 1U << i, cnt);
+    }
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(uart3_echo_stats);
+
+/*
+ * /dev and debugfs name: DT label if given, else after the UART's alias
+ * (the serdev node is a child of the controller, e.g. &uart3 -> uart3_echo),
+ * else after the serdev device itself.
+ */
+static void uart3_echo_set_name(struct uart3_echo_priv *priv, struct device *dev)
+{
+    struct device_node *ctrl;
+    const char *label;
+    int id = -ENODEV;
+
+    if (!device_property_read_string(dev, "label", &label)) {
+        strscpy(priv->name, label, sizeof(priv->name));
+        return;
+    }
+
+    ctrl = of_get_parent(dev->of_node);
+    if (ctrl) {
+        id = of_alias_get_id(ctrl, "uart");
+        if (id >= 0)
+            snprintf(priv->name, sizeof(priv->name), "uart%d_echo", id);
+        else if ((id = of_alias_get_id(ctrl, "serial")) >= 0)
+            snprintf(priv->name, sizeof(priv->name), "serial%d_echo", id);
+        of_node_put(ctrl);
+    }
+    if (id < 0)
+        snprintf(priv->name, sizeof(priv->name), "%s_echo", dev_name(dev));
+}
+
+/*
+ * Mark the instance gone and close the port with nothing left that could
+ * touch it: no new TX once gone is set, so stop the drain first;
+ * throttle()/unthrottle() test gone under flow_lock, so RTS stays put.
+ * rx_kick_work never touches the port, but receive_buf may queue it
+ * until the close returns.
+ */
+static void uart3_echo_close(struct uart3_echo_priv *priv)
+{
+    mutex_lock(&priv->tx_lock);
+    priv->gone = true;
+    mutex_unlock(&priv->tx_lock);
+    cancel_work_sync(&priv->tx_work);
+    mutex_lock(&priv->flow_lock);
+    priv->throttled = false;
+    mutex_unlock(&priv->flow_lock);
+    serdev_device_close(priv->serdev);
+    cancel_work_sync(&priv->rx_kick_work);
+}
+
 static int uart3_echo_probe(struct serdev_device *serdev)
 {
     struct device *dev = &serdev->dev;
@@ -204,25 +1799,92 @@ static int uart3_echo_probe(struct serdev_device *serdev)
     u32 baud = 115200;
     bool echo_back = false;
     u32 period_ms = 1000;
+    u32 fifo_size = UART3_ECHO_RX_RING_SIZE;
+    u32 tx_fifo_size = UART3_ECHO_TX_FIFO_SIZE;
+    struct uart3_echo_framing framing = { .max_frame = UART3_ECHO_MAX_FRAME };
+    const char *policy;
+    const char *framing_name;
 
     device_property_read_u32(dev, "current-speed", &baud);
     echo_back = device_property_read_bool(dev, "echo");
     device_property_read_u32(dev, "poll-period-ms", &period_ms);
+    device_property_read_u32(dev, "rx-fifo-size", &fifo_size);
+    device_property_read_u32(dev, "tx-fifo-size", &tx_fifo_size);
+    device_property_read_u32(dev, "max-frame-size", &framing.max_frame);
 
-    priv = devm_kzalloc(dev, sizeof(*priv), GFP_KERNEL);
+    /* not devm: open files may keep priv past remove() */
+    priv = kzalloc(sizeof(*priv), GFP_KERNEL);
     if (!priv)
         return -ENOMEM;
+    kref_init(&priv->ref);
+    uart3_echo_set_name(priv, dev);
+
+    device_property_read_u32(dev, "rx-wakeup-bytes", &priv->wakeup.min_bytes);
+    device_property_read_u32(dev, "rx-wakeup-us", &priv->wakeup.timeout_us);
 
     priv->serdev = serdev;
     priv->echo_back = echo_back;
     priv->baud = baud;
     priv->period_ms = period_ms;
-    spin_lock_init(&priv->fifo_lock);
-    init_waitqueue_head(&priv->read_wq);
-    ret = kfifo_alloc(&priv->fifo, 4096, GFP_KERNEL);
+    priv->flow_control = device_property_read_bool(dev, "uart-has-rtscts");
+    priv->overflow = UART3_ECHO_DROP_NEWEST;
+    if (!device_property_read_string(dev, "overflow-policy", &policy)) {
+        ret = match_string(uart3_echo_overflow_names,
+                           ARRAY_SIZE(uart3_echo_overflow_names), policy);
+        if (ret < 0) {
+            dev_err(dev, "unknown overflow-policy \"%s\"\n", policy);
+            goto err_free_priv;
+        }
+        priv->overflow = ret;
+    }
+    if (priv->overflow == UART3_ECHO_BACKPRESSURE && !priv->flow_control)
+        dev_warn(dev, "backpressure without uart-has-rtscts only relies on driver and tty buffering\n");
+    if (!device_property_read_string(dev, "framing", &framing_name)) {
+        ret = match_string(uart3_echo_framing_names,
+                           ARRAY_SIZE(uart3_echo_framing_names), framing_name);
+        if (ret < 0) {
+            dev_err(dev, "unknown framing \"%s\"\n", framing_name);
+            goto err_free_priv;
+        }
+        framing.type = ret;
+    }
+    if (device_property_read_bool(dev, "rx-timestamps"))
+        framing.flags |= UART3_ECHO_FRAMING_F_TIMESTAMP;
+    mutex_init(&priv->flow_lock);
+    init_rwsem(&priv->read_lock);
+    mutex_init(&priv->rx_lock);
+    INIT_WORK(&priv->rx_kick_work, uart3_echo_rx_kick);
+    spin_lock_init(&priv->readers_lock);
+    INIT_LIST_HEAD(&priv->readers);
+    ret = uart3_echo_ring_alloc(&priv->rx, fifo_size);
     if (ret) {
-        dev_err(dev, "failed to alloc fifo: %d\n", ret);
-        return ret;
+        dev_err(dev, "failed to alloc rx ring: %d\n", ret);
+        goto err_free_priv;
+    }
+    if (priv->overflow == UART3_ECHO_BACKPRESSURE) {
+        priv->stash = kmalloc(UART3_ECHO_STASH_SIZE, GFP_KERNEL);
+        if (!priv->stash) {
+            ret = -ENOMEM;
+            goto err_free_rx;
+        }
+    }
+    if (priv->wakeup.min_bytes > priv->rx.size) {
+        dev_warn(dev, "rx-wakeup-bytes %u clamped to ring size %u\n",
+                 priv->wakeup.min_bytes, priv->rx.size);
+        priv->wakeup.min_bytes = priv->rx.size;
+    }
+    ret = uart3_echo_set_framing(priv, &framing);
+    if (ret) {
+        dev_err(dev, "bad framing config (max-frame-size %u): %d\n", framing.max_frame, ret);
+        goto err_free_rx;
+    }
+    mutex_init(&priv->tx_lock);
+    init_waitqueue_head(&priv->write_wq);
+    INIT_WORK(&priv->tx_work, uart3_echo_tx_work);
+    ret = kfifo_alloc(&priv->tx_fifo, tx_fifo_size, GFP_KERNEL);
+    if (ret) {
+        dev_err(dev, "failed to alloc tx fifo: %d\n", ret);
+        goto err_free_rx;
     }
     serdev_device_set_drvdata(serdev, priv);
 
@@ -231,11 +1893,10 @@ static int uart3_echo_probe(struct serdev_device *serdev)
     ret = serdev_device_open(serdev);
     if (ret) {
         dev_err(dev, "failed to open serdev: %d\n", ret);
-        kfifo_free(&priv->fifo);
-        return ret;
+        goto err_free_tx;
     }
 
-    serdev_device_set_flow_control(serdev, false);
+    serdev_device_set_flow_control(serdev, priv->flow_control);
     ret = serdev_device_set_baudrate(serdev, baud);
     if (!ret)
         dev_info(dev, "configured baudrate %u\n", baud);
@@ -243,7 +1904,7 @@ static int uart3_echo_probe(struct serdev_device *serdev)
     // Send a greeting to help testing (will be received back if loopback wired)
     {
         const char hello[] = "[kernel] uart3-echo online\r\n";
-        serdev_device_write_buf(serdev, hello, sizeof(hello) - 1);
+        uart3_echo_tx_queue(priv, hello, sizeof(hello) - 1);
     }
 
     INIT_DELAYED_WORK(&priv->poll_work, uart3_echo_poll);
@@ -251,31 +1912,57 @@ static int uart3_echo_probe(struct serdev_device *serdev)
 
     /* Register misc chardev for userspace access */
     priv->miscdev.minor = MISC_DYNAMIC_MINOR;
-    priv->miscdev.name = "uart3_echo";
+    priv->miscdev.name = priv->name;
     priv->miscdev.fops = &uart3_echo_fops;
     priv->miscdev.parent = dev;
     ret = misc_register(&priv->miscdev);
     if (ret) {
-        dev_err(dev, "failed to register miscdev: %d\n", ret);
+        dev_err(dev, "failed to register miscdev %s: %d\n", priv->name, ret);
         cancel_delayed_work_sync(&priv->poll_work);
-        serdev_device_close(serdev);
-        kfifo_free(&priv->fifo);
-        return ret;
+        uart3_echo_close(priv); /* the greeting may be on its way out */
+        goto err_free_tx;
     }
 
-    dev_info(dev, "echo_back=%d, poll-period-ms=%u\n", priv->echo_back, priv->period_ms);
+    priv->debugfs = debugfs_create_dir(priv->name, NULL);
+    debugfs_create_file("stats", 0444, priv->debugfs, priv, &uart3_echo_stats_fops);
+
+    dev_info(dev, "/dev/%s: echo_back=%d, poll-period-ms=%u, rx-fifo-size=%u, overflow-policy=%s, rtscts=%d, framing=%s, rx-wakeup=%u bytes/%u us\n",
+             priv->name, priv->echo_back, priv->period_ms, priv->rx.size,
+             uart3_echo_overflow_names[priv->overflow], priv->flow_control,
+             uart3_echo_framing_names[priv->framing.type],
+             priv->wakeup.min_bytes, priv->wakeup.timeout_us);
     return 0;
+
+err_free_tx:
+    kfifo_free(&priv->tx_fifo);
+err_free_rx:
+    kfree(priv->stash);
+    kfree(priv->dec.buf);
+    uart3_echo_ring_free(&priv->rx);
+err_free_priv:
+    kfree(priv);
+    return ret;
 }
 
 static void uart3_echo_remove(struct serdev_device *serdev)
 {
     struct uart3_echo_priv *priv = serdev_device_get_drvdata(serdev);
-    if (priv) {
-        cancel_delayed_work_sync(&priv->poll_work);
-        misc_deregister(&priv->miscdev);
-        kfifo_free(&priv->fifo);
-    }
-    serdev_device_close(serdev);
+    struct uart3_echo_reader *r;
+    unsigned long flags;
+
+    debugfs_remove_recursive(priv->debugfs);
+    cancel_delayed_work_sync(&priv->poll_work);
+    misc_deregister(&priv->miscdev);
+
+    uart3_echo_close(priv);
+
+    /* files still open see EOF/-ENODEV; the last one frees priv */
+    spin_lock_irqsave(&priv->readers_lock, flags);
+    list_for_each_entry(r, &priv->readers, node)
+        wake_up_interruptible_poll(&r->wq, EPOLLHUP);
+    spin_unlock_irqrestore(&priv->readers_lock, flags);
+    wake_up_interruptible_poll(&priv->write_wq, EPOLLHUP);
+    kref_put(&priv->ref, uart3_echo_priv_release);
 }
 
 static const struct of_device_id uart3_echo_of_match[] = {
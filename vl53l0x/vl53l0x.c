@@ -1,33 +1,1171 @@
-// Minimal VL53L0X I2C kernel module skeleton (register access + XSHUT control)
-// NOTE: This does not implement full ranging; ST's full init/algorithms are not public.
+// VL53L0X I2C driver: ranging init, continuous back-to-back ranging as an IIO
+// distance channel (triggered buffer, GPIO1 data-ready IRQ or polled), plus
+// raw register access and XSHUT control through sysfs. Several sensors on one
+// bus can be bound as an array with XSHUT-sequenced addressing and staggered
+// single-shot ranging into one combined buffer.
+// Bus accounting: tracepoints (vl53l0x_trace.h) and a debugfs stats block
+// (/sys/kernel/debug/vl53l0x-<i2c dev>/stats) with transfers, bytes (register
+// index + data; the I2C address byte is not counted) and bus time per kind
+// of work, and a sample latency histogram.
+// The init sequence follows the register-level flow of ST's API (as used by
+// the Pololu library): static SPAD selection from NVM, default tuning, VHV and
+// phase reference calibration, timing budget.
+// Needs kernel 6.16 or newer: iio_push_to_buffers_with_ts() (6.16), bool
+// iio_device_claim_direct() (6.15), hrtimer_setup() (6.13).
 
 #include <linux/module.h>
 #include <linux/i2c.h>
 #include <linux/of_device.h>
 #include <linux/regmap.h>
+#include <linux/property.h>
 #include <linux/gpio/consumer.h>
+#include <linux/interrupt.h>
+#include <linux/hrtimer.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
+#include <linux/math64.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/unaligned.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/trigger.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
+
+#include "vl53l0x.h"
+
+#define CREATE_TRACE_POINTS
+#include "vl53l0x_trace.h"
+
+#define VL53L0X_SYSRANGE_START			0x00
+#define VL53L0X_SYSTEM_SEQUENCE_CONFIG		0x01
+#define VL53L0X_SYSTEM_INTERRUPT_CONFIG_GPIO	0x0A
+#define VL53L0X_SYSTEM_INTERRUPT_CLEAR		0x0B
+#define VL53L0X_RESULT_INTERRUPT_STATUS		0x13
+#define VL53L0X_RESULT_RANGE_STATUS		0x14
+#define VL53L0X_ALGO_PHASECAL_CONFIG_TIMEOUT	0x30 /* page 0 */
+#define VL53L0X_ALGO_PHASECAL_LIM		0x30 /* page 1 */
+#define VL53L0X_GLOBAL_CONFIG_VCSEL_WIDTH	0x32
+#define VL53L0X_FINAL_RANGE_MIN_COUNT_RATE	0x44
+#define VL53L0X_MSRC_CONFIG_TIMEOUT_MACROP	0x46
+#define VL53L0X_FINAL_RANGE_VALID_PHASE_LOW	0x47
+#define VL53L0X_FINAL_RANGE_VALID_PHASE_HIGH	0x48
+#define VL53L0X_DYNAMIC_SPAD_REF_EN_START_OFFSET 0x4F
+#define VL53L0X_DYNAMIC_SPAD_NUM_REQUESTED_REF	0x4E
+#define VL53L0X_PRE_RANGE_CONFIG_VCSEL_PERIOD	0x50
+#define VL53L0X_PRE_RANGE_CONFIG_TIMEOUT_HI	0x51
+#define VL53L0X_PRE_RANGE_VALID_PHASE_LOW	0x56
+#define VL53L0X_PRE_RANGE_VALID_PHASE_HIGH	0x57
+#define VL53L0X_MSRC_CONFIG_CONTROL		0x60
+#define VL53L0X_FINAL_RANGE_CONFIG_VCSEL_PERIOD	0x70
+#define VL53L0X_FINAL_RANGE_CONFIG_TIMEOUT_HI	0x71
+#define VL53L0X_GPIO_HV_MUX_ACTIVE_HIGH		0x84
+#define VL53L0X_VHV_CONFIG_PAD_SCL_SDA_EXTSUP_HV 0x89
+#define VL53L0X_SPAD_ENABLES_REF_0		0xB0
+#define VL53L0X_REF_EN_START_SELECT		0xB6
+#define VL53L0X_IDENTIFICATION_MODEL_ID		0xC0
+#define VL53L0X_VHV_SETTINGS			0xCB
+#define VL53L0X_PHASECAL_CONFIG			0xEE
+#define VL53L0X_PAGE_SELECT			0xFF
+#define VL53L0X_MODEL_ID			0xEE
+
+/* SYSRANGE_START modes */
+#define VL53L0X_MODE_SINGLESHOT			0x01
+#define VL53L0X_MODE_BACK_TO_BACK		0x02
+
+/* SYSTEM_SEQUENCE_CONFIG: DSS, pre-range, final-range (MSRC and TCC off) */
+#define VL53L0X_SEQ_DEFAULT			0xE8
+#define VL53L0X_SEQ_VHV_CAL			0x01
+#define VL53L0X_SEQ_PHASE_CAL			0x02
+
+/* Result block at RESULT_INTERRUPT_STATUS: status, range status, ..., range */
+#define VL53L0X_RESULT_LEN			13
+#define VL53L0X_RESULT_RANGE_OFF		11
+
+/* 20 ms is the shortest budget ST supports: ~50 Hz back-to-back */
+#define VL53L0X_BUDGET_MIN_US			20000
+#define VL53L0X_BUDGET_MAX_US			1000000
+#define VL53L0X_TIMEOUT_US			500000
+
+/*
+ * Arrays: every part boots at 0x29, so XSHUT is released one sensor at a
+ * time and each is moved to its DT address before the next comes up
+ */
+#define VL53L0X_I2C_SLAVE_DEVICE_ADDRESS	0x8A
+#define VL53L0X_MAX_SENSORS			8
+/* single-shot slack per array cycle on top of the timing budget */
+#define VL53L0X_ARRAY_MARGIN_US			2000
+
+#define VL53L0X_LAT_BUCKETS			21 /* log2(us) up to ~1 s, last open-ended */
+
+/* What a bus transfer was for: set with data->lock held, see vl53l0x_lock() */
+enum vl53l0x_op {
+	VL53L0X_OP_CONFIG, /* init, calibration, budget/profile changes */
+	VL53L0X_OP_SAMPLE, /* starting shots, polling and reading results */
+	VL53L0X_OP_RAW, /* sysfs register access */
+	VL53L0X_OP_NUM,
+};
+
+static const char * const vl53l0x_op_names[] = {
+	[VL53L0X_OP_CONFIG] = "config",
+	[VL53L0X_OP_SAMPLE] = "sample",
+	[VL53L0X_OP_RAW] = "raw",
+};
+
+/*
+ * Counted per transfer that reaches the bus (cache hits are free). An array
+ * adds up all of its sensors; the tracepoints tell them apart.
+ */
+struct vl53l0x_stats {
+	atomic64_t xfers[VL53L0X_OP_NUM];
+	atomic64_t bytes[VL53L0X_OP_NUM]; /* register index + data, no address byte */
+	atomic64_t bus_ns[VL53L0X_OP_NUM];
+	atomic64_t errors; /* failed transfers */
+	atomic64_t not_ready; /* result polls with no new measurement */
+	atomic64_t samples;
+	atomic64_t lat[VL53L0X_LAT_BUCKETS]; /* IRQ or request -> result read */
+};
+
+struct vl53l0x_sensor {
+	struct regmap *regmap;
+	struct vl53l0x_stats *stats;
+	struct gpio_desc *xshutdown; /* optional for a single sensor, active-low */
+	u8 addr;
+	u8 stop_variable; /* read from the part at init, needed to start ranging */
+	/* ranging config, re-applied by every init */
+	u32 budget_us;
+	u8 pre_vcsel, final_vcsel; /* VCSEL pulse periods, PCLKs */
+	u16 signal_limit; /* final range min signal rate, MCPS Q9.7 */
+	bool busy; /* array: single-shot started, result not read yet */
+	bool paged; /* raw access left a page other than 0 selected: cache bypassed */
+	/* SPAD/ref calibration: taken by the first init, reused by later ones */
+	struct vl53l0x_cal cal;
+	bool cal_valid;
+};
 
 struct vl53l0x_data {
 	struct i2c_client *client;
-	struct regmap *regmap;
-	struct gpio_desc *xshutdown; /* optional, active-low */
-	u16 reg_addr; /* sysfs-selected register address (16-bit) */
+	struct regmap *regmap; /* client address (0x29 for an array) */
+	u16 reg_addr; /* sysfs-selected register address */
+	u8 reg_sensor; /* sysfs-selected sensor for reg_*, regs, reg_seq, xshut */
+
+	/* serializes register sequences (several of them switch page via 0xFF) */
+	struct mutex lock;
+	enum vl53l0x_op op; /* accounting class of the bus traffic under lock */
+	struct vl53l0x_stats stats;
+	struct vl53l0x_sensor sensors[VL53L0X_MAX_SENSORS];
+	unsigned int num_sensors;
+	unsigned int profile; /* index into vl53l0x_profiles, same for all sensors */
+	bool custom; /* budget set through integration_time/sampling_frequency */
+	int freq_avail[10]; /* sampling_frequency for vl53l0x_budget_avail */
+	bool array;
+	int irq; /* GPIO1, single sensor only */
+
+	/*
+	 * Buffered mode runs a single sensor back-to-back. With GPIO1 wired the
+	 * data-ready IRQ reads the result and fires the trigger; without it an
+	 * hrtimer polls the interrupt status at half the budget.
+	 * An array is driven by the hrtimer in slots of cycle / num_sensors: each
+	 * slot reads one sensor's result and starts its next single-shot, so
+	 * starts are staggered and the bus carries one sensor's traffic at a
+	 * time. The combined scan is pushed once per cycle.
+	 */
+	struct iio_trigger *trig;
+	struct hrtimer timer;
+	ktime_t period;
+	unsigned int slot;
+	bool primed; /* array: first cycle only starts the shots */
+	unsigned long scan_masks[2];
+	struct completion done; /* single-shot result read by the IRQ thread */
+	bool measuring; /* vl53l0x_measure() waits on done, under lock */
+	int done_ret;
+	s64 irq_ts;
+
+	struct {
+		u16 range[VL53L0X_MAX_SENSORS]; /* mm */
+		aligned_s64 ts;
+	} scan;
+
+	/* reg_seq: READ results of the last script, and the merge buffer */
+	size_t seq_result_len;
+	u8 seq_result[VL53L0X_REG_SEQ_MAX];
+	u8 seq_wbuf[256];
+};
+
+/*
+ * Register map. Addresses 0x00-0xFE are banked by PAGE_SELECT (0xFF), and
+ * ST's sequences write pages 1, 6 and 7 at addresses that alias page 0
+ * registers (0x30, 0x44-0x48, ...). The cache therefore only holds page 0
+ * configuration registers that no paged write ever touches; everything else,
+ * including the result block, interrupt status, the special-access registers
+ * (0x80-0x83, 0x88, 0x91) and the I2C address, is volatile.
+ */
+static const struct regmap_range vl53l0x_cached_ranges[] = {
+	regmap_reg_range(VL53L0X_SYSTEM_SEQUENCE_CONFIG, VL53L0X_SYSTEM_SEQUENCE_CONFIG),
+	regmap_reg_range(VL53L0X_SYSTEM_INTERRUPT_CONFIG_GPIO,
+			 VL53L0X_SYSTEM_INTERRUPT_CONFIG_GPIO),
+	regmap_reg_range(VL53L0X_GLOBAL_CONFIG_VCSEL_WIDTH, VL53L0X_GLOBAL_CONFIG_VCSEL_WIDTH),
+	regmap_reg_range(VL53L0X_PRE_RANGE_CONFIG_VCSEL_PERIOD, 0x52), /* + timeout */
+	regmap_reg_range(VL53L0X_PRE_RANGE_VALID_PHASE_LOW, VL53L0X_PRE_RANGE_VALID_PHASE_HIGH),
+	regmap_reg_range(VL53L0X_MSRC_CONFIG_CONTROL, VL53L0X_MSRC_CONFIG_CONTROL),
+	regmap_reg_range(VL53L0X_FINAL_RANGE_CONFIG_VCSEL_PERIOD, 0x72), /* + timeout */
+	regmap_reg_range(VL53L0X_GPIO_HV_MUX_ACTIVE_HIGH, VL53L0X_GPIO_HV_MUX_ACTIVE_HIGH),
+	regmap_reg_range(VL53L0X_VHV_CONFIG_PAD_SCL_SDA_EXTSUP_HV,
+			 VL53L0X_VHV_CONFIG_PAD_SCL_SDA_EXTSUP_HV),
+	regmap_reg_range(VL53L0X_SPAD_ENABLES_REF_0, VL53L0X_REF_EN_START_SELECT),
+};
+
+static const struct regmap_range vl53l0x_all_ranges[] = {
+	regmap_reg_range(0x00, VL53L0X_PAGE_SELECT),
+};
+
+static const struct regmap_access_table vl53l0x_volatile_table = {
+	.yes_ranges = vl53l0x_all_ranges,
+	.n_yes_ranges = ARRAY_SIZE(vl53l0x_all_ranges),
+	.no_ranges = vl53l0x_cached_ranges,
+	.n_no_ranges = ARRAY_SIZE(vl53l0x_cached_ranges),
+};
+
+/* result block and identification are read-only on page 0 */
+static const struct regmap_range vl53l0x_ro_ranges[] = {
+	regmap_reg_range(VL53L0X_RESULT_INTERRUPT_STATUS,
+			 VL53L0X_RESULT_INTERRUPT_STATUS + VL53L0X_RESULT_LEN - 1),
+	regmap_reg_range(VL53L0X_IDENTIFICATION_MODEL_ID, 0xC2),
+};
+
+static const struct regmap_access_table vl53l0x_wr_table = {
+	.yes_ranges = vl53l0x_all_ranges,
+	.n_yes_ranges = ARRAY_SIZE(vl53l0x_all_ranges),
+	.no_ranges = vl53l0x_ro_ranges,
+	.n_no_ranges = ARRAY_SIZE(vl53l0x_ro_ranges),
+};
+
+static const struct regmap_access_table vl53l0x_rd_table = {
+	.yes_ranges = vl53l0x_all_ranges,
+	.n_yes_ranges = ARRAY_SIZE(vl53l0x_all_ranges),
 };
 
 static const struct regmap_config vl53l0x_regmap_cfg = {
-	.reg_bits = 16,
+	.reg_bits = 8,
 	.val_bits = 8,
-	.max_register = 0xFFFF,
-	.cache_type = REGCACHE_NONE,
+	.max_register = VL53L0X_PAGE_SELECT,
+	.rd_table = &vl53l0x_rd_table,
+	.wr_table = &vl53l0x_wr_table,
+	.volatile_table = &vl53l0x_volatile_table,
+	.cache_type = REGCACHE_MAPLE,
+};
+
+/*
+ * Plain I2C regmap bus with accounting: one context per I2C address (an
+ * array has the boot address plus one per sensor), all counting into the
+ * instance's stats
+ */
+struct vl53l0x_bus {
+	struct i2c_client *client;
+	struct vl53l0x_data *data;
+};
+
+static void vl53l0x_account(struct vl53l0x_bus *bus, bool write, u8 reg,
+			    size_t len, u64 t0, int ret)
+{
+	struct vl53l0x_stats *st = &bus->data->stats;
+	enum vl53l0x_op op = READ_ONCE(bus->data->op);
+	u64 ns = ktime_get_ns() - t0;
+
+	atomic64_inc(&st->xfers[op]);
+	atomic64_add(len, &st->bytes[op]);
+	atomic64_add(ns, &st->bus_ns[op]);
+	if (ret)
+		atomic64_inc(&st->errors);
+	trace_vl53l0x_xfer(bus->client->addr, write, reg, len, ns, ret);
+}
+
+static int vl53l0x_bus_write(void *context, const void *buf, size_t count)
+{
+	struct vl53l0x_bus *bus = context;
+	u64 t0 = ktime_get_ns();
+	int ret = i2c_master_send(bus->client, buf, count);
+
+	if (ret >= 0)
+		ret = ret == count ? 0 : -EIO;
+	vl53l0x_account(bus, true, *(const u8 *)buf, count, t0, ret);
+	return ret;
+}
+
+static int vl53l0x_bus_read(void *context, const void *reg, size_t reg_size,
+			    void *val, size_t val_size)
+{
+	struct vl53l0x_bus *bus = context;
+	struct i2c_msg msgs[] = {
+		{ .addr = bus->client->addr, .len = reg_size, .buf = (u8 *)reg },
+		{ .addr = bus->client->addr, .flags = I2C_M_RD, .len = val_size, .buf = val },
+	};
+	u64 t0 = ktime_get_ns();
+	int ret = i2c_transfer(bus->client->adapter, msgs, ARRAY_SIZE(msgs));
+
+	if (ret >= 0)
+		ret = ret == ARRAY_SIZE(msgs) ? 0 : -EIO;
+	vl53l0x_account(bus, false, *(const u8 *)reg, reg_size + val_size, t0, ret);
+	return ret;
+}
+
+static const struct regmap_bus vl53l0x_regmap_bus = {
+	.write = vl53l0x_bus_write,
+	.read = vl53l0x_bus_read,
+};
+
+static struct regmap *vl53l0x_regmap_init(struct vl53l0x_data *data,
+					  struct i2c_client *client)
+{
+	struct vl53l0x_bus *bus;
+
+	bus = devm_kzalloc(&client->dev, sizeof(*bus), GFP_KERNEL);
+	if (!bus)
+		return ERR_PTR(-ENOMEM);
+	bus->client = client;
+	bus->data = data;
+	return devm_regmap_init(&client->dev, &vl53l0x_regmap_bus, bus,
+				&vl53l0x_regmap_cfg);
+}
+
+/* data->lock plus the accounting class of the bus traffic while it is held */
+static void vl53l0x_lock(struct vl53l0x_data *data, enum vl53l0x_op op)
+{
+	mutex_lock(&data->lock);
+	WRITE_ONCE(data->op, op);
+}
+
+/* for the IRQ thread, which must not block behind vl53l0x_measure() */
+static bool vl53l0x_trylock(struct vl53l0x_data *data, enum vl53l0x_op op)
+{
+	if (!mutex_trylock(&data->lock))
+		return false;
+	WRITE_ONCE(data->op, op);
+	return true;
+}
+
+static void vl53l0x_unlock(struct vl53l0x_data *data)
+{
+	WRITE_ONCE(data->op, VL53L0X_OP_CONFIG);
+	mutex_unlock(&data->lock);
+}
+
+/*
+ * Ranging core: register sequences
+ */
+
+static int vl53l0x_read16(struct vl53l0x_sensor *s, u8 reg, u16 *val)
+{
+	__be16 buf;
+	int ret = regmap_bulk_read(s->regmap, reg, &buf, sizeof(buf));
+	if (ret)
+		return ret;
+	*val = be16_to_cpu(buf);
+	return 0;
+}
+
+static int vl53l0x_write16(struct vl53l0x_sensor *s, u8 reg, u16 val)
+{
+	__be16 buf = cpu_to_be16(val);
+
+	return regmap_bulk_write(s->regmap, reg, &buf, sizeof(buf));
+}
+
+/* DefaultTuningSettings from ST's API (undocumented registers, pages 0/1) */
+static const struct reg_sequence vl53l0x_tuning[] = {
+	{ 0xFF, 0x01 }, { 0x00, 0x00 },
+	{ 0xFF, 0x00 }, { 0x09, 0x00 }, { 0x10, 0x00 }, { 0x11, 0x00 },
+	{ 0x24, 0x01 }, { 0x25, 0xFF }, { 0x75, 0x00 },
+	{ 0xFF, 0x01 }, { 0x4E, 0x2C }, { 0x48, 0x00 }, { 0x30, 0x20 },
+	{ 0xFF, 0x00 }, { 0x30, 0x09 }, { 0x54, 0x00 }, { 0x31, 0x04 },
+	{ 0x32, 0x03 }, { 0x40, 0x83 }, { 0x46, 0x25 }, { 0x60, 0x00 },
+	{ 0x27, 0x00 }, { 0x50, 0x06 }, { 0x51, 0x00 }, { 0x52, 0x96 },
+	{ 0x56, 0x08 }, { 0x57, 0x30 }, { 0x61, 0x00 }, { 0x62, 0x00 },
+	{ 0x64, 0x00 }, { 0x65, 0x00 }, { 0x66, 0xA0 },
+	{ 0xFF, 0x01 }, { 0x22, 0x32 }, { 0x47, 0x14 }, { 0x49, 0xFF },
+	{ 0x4A, 0x00 },
+	{ 0xFF, 0x00 }, { 0x7A, 0x0A }, { 0x7B, 0x00 }, { 0x78, 0x21 },
+	{ 0xFF, 0x01 }, { 0x23, 0x34 }, { 0x42, 0x00 }, { 0x44, 0xFF },
+	{ 0x45, 0x26 }, { 0x46, 0x05 }, { 0x40, 0x40 }, { 0x0E, 0x06 },
+	{ 0x20, 0x1A }, { 0x43, 0x40 },
+	{ 0xFF, 0x00 }, { 0x34, 0x03 }, { 0x35, 0x44 },
+	{ 0xFF, 0x01 }, { 0x31, 0x04 }, { 0x4B, 0x09 }, { 0x4C, 0x05 },
+	{ 0x4D, 0x04 },
+	{ 0xFF, 0x00 }, { 0x44, 0x00 }, { 0x45, 0x20 }, { 0x47, 0x08 },
+	{ 0x48, 0x28 }, { 0x67, 0x00 }, { 0x70, 0x04 }, { 0x71, 0x01 },
+	{ 0x72, 0xFE }, { 0x76, 0x00 }, { 0x77, 0x00 },
+	{ 0xFF, 0x01 }, { 0x0D, 0x01 },
+	{ 0xFF, 0x00 }, { 0x80, 0x01 }, { 0x01, 0xF8 },
+	{ 0xFF, 0x01 }, { 0x8E, 0x01 }, { 0x00, 0x01 },
+	{ 0xFF, 0x00 }, { 0x80, 0x00 },
 };
 
+/* Restores the stop variable; every ranging start is preceded by this */
+static int vl53l0x_unlock_stop(struct vl53l0x_sensor *s)
+{
+	const struct reg_sequence seq[] = {
+		{ 0x80, 0x01 }, { 0xFF, 0x01 }, { 0x00, 0x00 },
+		{ 0x91, s->stop_variable },
+		{ 0x00, 0x01 }, { 0xFF, 0x00 }, { 0x80, 0x00 },
+	};
+
+	return regmap_multi_reg_write(s->regmap, seq, ARRAY_SIZE(seq));
+}
+
+static int vl53l0x_wait_irq_status(struct vl53l0x_sensor *s)
+{
+	unsigned int val;
+
+	return regmap_read_poll_timeout(s->regmap, VL53L0X_RESULT_INTERRUPT_STATUS,
+					val, val & 0x07, 1000, VL53L0X_TIMEOUT_US);
+}
+
+/* Reference SPAD count and type from NVM */
+static int vl53l0x_get_spad_info(struct vl53l0x_sensor *s, u8 *count, bool *aperture)
+{
+	static const struct reg_sequence enter[] = {
+		{ 0x80, 0x01 }, { 0xFF, 0x01 }, { 0x00, 0x00 }, { 0xFF, 0x06 },
+	};
+	static const struct reg_sequence fetch[] = {
+		{ 0xFF, 0x07 }, { 0x81, 0x01 }, { 0x80, 0x01 },
+		{ 0x94, 0x6B }, { 0x83, 0x00 },
+	};
+	static const struct reg_sequence leave[] = {
+		{ 0xFF, 0x01 }, { 0x00, 0x01 }, { 0xFF, 0x00 }, { 0x80, 0x00 },
+	};
+	unsigned int val;
+	int ret;
+
+	ret = regmap_multi_reg_write(s->regmap, enter, ARRAY_SIZE(enter));
+	if (ret)
+		return ret;
+	ret = regmap_update_bits(s->regmap, 0x83, 0x04, 0x04);
+	if (ret)
+		return ret;
+	ret = regmap_multi_reg_write(s->regmap, fetch, ARRAY_SIZE(fetch));
+	if (ret)
+		return ret;
+	ret = regmap_read_poll_timeout(s->regmap, 0x83, val, val, 1000,
+				       VL53L0X_TIMEOUT_US);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, 0x83, 0x01);
+	if (ret)
+		return ret;
+	ret = regmap_read(s->regmap, 0x92, &val);
+	if (ret)
+		return ret;
+	*count = val & 0x7F;
+	*aperture = val & 0x80;
+
+	ret = regmap_write(s->regmap, 0x81, 0x00);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, 0xFF, 0x06);
+	if (ret)
+		return ret;
+	ret = regmap_update_bits(s->regmap, 0x83, 0x04, 0x00);
+	if (ret)
+		return ret;
+	return regmap_multi_reg_write(s->regmap, leave, ARRAY_SIZE(leave));
+}
+
+/* Enable the first @count reference SPADs of the right type in the NVM map */
+static int vl53l0x_set_ref_spads(struct vl53l0x_sensor *s, u8 count, bool aperture)
+{
+	static const struct reg_sequence setup[] = {
+		{ 0xFF, 0x01 },
+		{ VL53L0X_DYNAMIC_SPAD_REF_EN_START_OFFSET, 0x00 },
+		{ VL53L0X_DYNAMIC_SPAD_NUM_REQUESTED_REF, 0x2C },
+		{ 0xFF, 0x00 },
+		{ VL53L0X_REF_EN_START_SELECT, 0xB4 },
+	};
+	unsigned int first = aperture ? 12 : 0; /* aperture SPADs start at 12 */
+	unsigned int i, enabled = 0;
+	u8 map[6];
+	int ret;
+
+	ret = regmap_bulk_read(s->regmap, VL53L0X_SPAD_ENABLES_REF_0, map, sizeof(map));
+	if (ret)
+		return ret;
+	ret = regmap_multi_reg_write(s->regmap, setup, ARRAY_SIZE(setup));
+	if (ret)
+		return ret;
+
+	for (i = 0; i < 48; i++) {
+		if (i < first || enabled == count)
+			map[i / 8] &= ~BIT(i % 8);
+		else if (map[i / 8] & BIT(i % 8))
+			enabled++;
+	}
+	ret = regmap_bulk_write(s->regmap, VL53L0X_SPAD_ENABLES_REF_0, map, sizeof(map));
+	if (ret)
+		return ret;
+	s->cal.spad_count = enabled;
+	s->cal.spad_aperture = aperture;
+	memcpy(s->cal.ref_spad_map, map, sizeof(map));
+	return 0;
+}
+
+/* Stored reference SPAD map, without the NVM lookup */
+static int vl53l0x_restore_ref_spads(struct vl53l0x_sensor *s)
+{
+	static const struct reg_sequence setup[] = {
+		{ 0xFF, 0x01 },
+		{ VL53L0X_DYNAMIC_SPAD_REF_EN_START_OFFSET, 0x00 },
+		{ VL53L0X_DYNAMIC_SPAD_NUM_REQUESTED_REF, 0x2C },
+		{ 0xFF, 0x00 },
+		{ VL53L0X_REF_EN_START_SELECT, 0xB4 },
+	};
+	int ret;
+
+	ret = regmap_multi_reg_write(s->regmap, setup, ARRAY_SIZE(setup));
+	if (ret)
+		return ret;
+	return regmap_bulk_write(s->regmap, VL53L0X_SPAD_ENABLES_REF_0,
+				 s->cal.ref_spad_map, sizeof(s->cal.ref_spad_map));
+}
+
+/* VHV and phase calibration results, read back or restored (ST's ref_calibration_io) */
+static int vl53l0x_ref_cal_io(struct vl53l0x_sensor *s, bool read)
+{
+	static const struct reg_sequence enter[] = {
+		{ 0xFF, 0x01 }, { 0x00, 0x00 }, { 0xFF, 0x00 },
+	};
+	static const struct reg_sequence leave[] = {
+		{ 0xFF, 0x01 }, { 0x00, 0x01 }, { 0xFF, 0x00 },
+	};
+	unsigned int val;
+	int ret;
+
+	ret = regmap_multi_reg_write(s->regmap, enter, ARRAY_SIZE(enter));
+	if (ret)
+		return ret;
+	if (read) {
+		ret = regmap_read(s->regmap, VL53L0X_VHV_SETTINGS, &val);
+		if (ret)
+			return ret;
+		s->cal.vhv_settings = val;
+		ret = regmap_read(s->regmap, VL53L0X_PHASECAL_CONFIG, &val);
+		if (ret)
+			return ret;
+		s->cal.phase_cal = val & 0x7F;
+	} else {
+		ret = regmap_write(s->regmap, VL53L0X_VHV_SETTINGS, s->cal.vhv_settings);
+		if (ret)
+			return ret;
+		/* bit 7 is not part of the calibration */
+		ret = regmap_update_bits(s->regmap, VL53L0X_PHASECAL_CONFIG, 0x7F,
+					 s->cal.phase_cal);
+		if (ret)
+			return ret;
+	}
+	return regmap_multi_reg_write(s->regmap, leave, ARRAY_SIZE(leave));
+}
+
+static int vl53l0x_single_ref_cal(struct vl53l0x_sensor *s, u8 seq, u8 vhv_init)
+{
+	int ret;
+
+	ret = regmap_write(s->regmap, VL53L0X_SYSTEM_SEQUENCE_CONFIG, seq);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_SYSRANGE_START,
+			   VL53L0X_MODE_SINGLESHOT | vhv_init);
+	if (ret)
+		return ret;
+	ret = vl53l0x_wait_irq_status(s);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_SYSTEM_INTERRUPT_CLEAR, 0x01);
+	if (ret)
+		return ret;
+	return regmap_write(s->regmap, VL53L0X_SYSRANGE_START, 0x00);
+}
+
+/*
+ * Timing budget. Timeouts are kept in macro periods (MCLKs) whose length
+ * depends on the VCSEL pulse period of the step.
+ */
+struct vl53l0x_seq_timeouts {
+	bool tcc, dss, msrc, pre_range, final_range;
+	u8 pre_vcsel_pclks, final_vcsel_pclks;
+	u32 msrc_dss_tcc_us, pre_range_us, final_range_us;
+	u32 pre_range_mclks;
+};
+
+static u32 vl53l0x_macro_period_ns(u8 vcsel_pclks)
+{
+	return (2304 * vcsel_pclks * 1655 + 500) / 1000;
+}
+
+static u32 vl53l0x_mclks_to_us(u32 mclks, u8 vcsel_pclks)
+{
+	return (mclks * vl53l0x_macro_period_ns(vcsel_pclks) + 500) / 1000;
+}
+
+static u32 vl53l0x_us_to_mclks(u32 us, u8 vcsel_pclks)
+{
+	u32 macro_ns = vl53l0x_macro_period_ns(vcsel_pclks);
+
+	return (us * 1000 + macro_ns / 2) / macro_ns;
+}
+
+/* Timeout registers: (LSB << MSB) + 1 MCLKs */
+static u32 vl53l0x_decode_timeout(u16 reg)
+{
+	return ((reg & 0xFF) << (reg >> 8)) + 1;
+}
+
+static u16 vl53l0x_encode_timeout(u32 mclks)
+{
+	u32 ls;
+	u16 ms = 0;
+
+	if (!mclks)
+		return 0;
+	ls = mclks - 1;
+	while (ls & ~0xFFu) {
+		ls >>= 1;
+		ms++;
+	}
+	return (ms << 8) | ls;
+}
+
+static int vl53l0x_get_timeouts(struct vl53l0x_sensor *s, struct vl53l0x_seq_timeouts *t)
+{
+	unsigned int seq, val;
+	u16 reg16;
+	u32 final_mclks;
+	int ret;
+
+	ret = regmap_read(s->regmap, VL53L0X_SYSTEM_SEQUENCE_CONFIG, &seq);
+	if (ret)
+		return ret;
+	t->tcc = seq & BIT(4);
+	t->dss = seq & BIT(3);
+	t->msrc = seq & BIT(2);
+	t->pre_range = seq & BIT(6);
+	t->final_range = seq & BIT(7);
+
+	/* VCSEL period registers hold (pclks / 2) - 1 */
+	ret = regmap_read(s->regmap, VL53L0X_PRE_RANGE_CONFIG_VCSEL_PERIOD, &val);
+	if (ret)
+		return ret;
+	t->pre_vcsel_pclks = (val + 1) << 1;
+	ret = regmap_read(s->regmap, VL53L0X_FINAL_RANGE_CONFIG_VCSEL_PERIOD, &val);
+	if (ret)
+		return ret;
+	t->final_vcsel_pclks = (val + 1) << 1;
+
+	ret = regmap_read(s->regmap, VL53L0X_MSRC_CONFIG_TIMEOUT_MACROP, &val);
+	if (ret)
+		return ret;
+	t->msrc_dss_tcc_us = vl53l0x_mclks_to_us(val + 1, t->pre_vcsel_pclks);
+
+	ret = vl53l0x_read16(s, VL53L0X_PRE_RANGE_CONFIG_TIMEOUT_HI, &reg16);
+	if (ret)
+		return ret;
+	t->pre_range_mclks = vl53l0x_decode_timeout(reg16);
+	t->pre_range_us = vl53l0x_mclks_to_us(t->pre_range_mclks, t->pre_vcsel_pclks);
+
+	ret = vl53l0x_read16(s, VL53L0X_FINAL_RANGE_CONFIG_TIMEOUT_HI, &reg16);
+	if (ret)
+		return ret;
+	final_mclks = vl53l0x_decode_timeout(reg16);
+	if (t->pre_range)
+		final_mclks -= t->pre_range_mclks;
+	t->final_range_us = vl53l0x_mclks_to_us(final_mclks, t->final_vcsel_pclks);
+	return 0;
+}
+
+/* Fixed per-step overheads from ST's API, in us */
+static u32 vl53l0x_budget_overhead(const struct vl53l0x_seq_timeouts *t)
+{
+	u32 us = 1910 + 960; /* start + end */
+
+	if (t->tcc)
+		us += t->msrc_dss_tcc_us + 590;
+	if (t->dss)
+		us += 2 * (t->msrc_dss_tcc_us + 690);
+	else if (t->msrc)
+		us += t->msrc_dss_tcc_us + 660;
+	if (t->pre_range)
+		us += t->pre_range_us + 660;
+	return us;
+}
+
+/* Gives whatever is left of @budget_us after the other steps to final range */
+static int vl53l0x_set_budget(struct vl53l0x_sensor *s, u32 budget_us)
+{
+	struct vl53l0x_seq_timeouts t;
+	u32 used, mclks;
+	int ret;
+
+	ret = vl53l0x_get_timeouts(s, &t);
+	if (ret)
+		return ret;
+	if (!t.final_range)
+		return -EINVAL;
+
+	used = vl53l0x_budget_overhead(&t) + 550;
+	if (used > budget_us)
+		return -EINVAL;
+
+	mclks = vl53l0x_us_to_mclks(budget_us - used, t.final_vcsel_pclks);
+	if (t.pre_range)
+		mclks += t.pre_range_mclks;
+	ret = vl53l0x_write16(s, VL53L0X_FINAL_RANGE_CONFIG_TIMEOUT_HI,
+			      vl53l0x_encode_timeout(mclks));
+	if (ret)
+		return ret;
+	s->budget_us = budget_us;
+	return 0;
+}
+
+/*
+ * VCSEL pulse periods with the phase windows ST pairs them with. Step
+ * timeouts are kept in us, so the budget has to be set again afterwards.
+ */
+static int vl53l0x_write_vcsel(struct vl53l0x_sensor *s, u8 pre_pclks, u8 final_pclks)
+{
+	/* final range: valid phase high, VCSEL width, phasecal timeout, phasecal limit */
+	static const u8 final_cfg[][4] = {
+		[0] = { 0x10, 0x02, 0x0C, 0x30 }, /* 8 PCLKs */
+		[1] = { 0x28, 0x03, 0x09, 0x20 }, /* 10 */
+		[2] = { 0x38, 0x03, 0x08, 0x20 }, /* 12 */
+		[3] = { 0x48, 0x03, 0x07, 0x20 }, /* 14 */
+	};
+	struct vl53l0x_seq_timeouts t;
+	const u8 *cfg;
+	u32 mclks;
+	int ret;
+
+	if (pre_pclks < 12 || pre_pclks > 18 || pre_pclks & 1 ||
+	    final_pclks < 8 || final_pclks > 14 || final_pclks & 1)
+		return -EINVAL;
+	ret = vl53l0x_get_timeouts(s, &t);
+	if (ret)
+		return ret;
+
+	/* pre-range: valid phase high = 0x18, 0x30, 0x40, 0x50 for 12..18 */
+	ret = regmap_write(s->regmap, VL53L0X_PRE_RANGE_VALID_PHASE_HIGH,
+			   pre_pclks == 12 ? 0x18 : ((pre_pclks - 8) / 2) << 4);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_PRE_RANGE_VALID_PHASE_LOW, 0x08);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_PRE_RANGE_CONFIG_VCSEL_PERIOD, (pre_pclks >> 1) - 1);
+	if (ret)
+		return ret;
+	mclks = vl53l0x_us_to_mclks(t.pre_range_us, pre_pclks);
+	ret = vl53l0x_write16(s, VL53L0X_PRE_RANGE_CONFIG_TIMEOUT_HI,
+			      vl53l0x_encode_timeout(mclks));
+	if (ret)
+		return ret;
+	mclks = vl53l0x_us_to_mclks(t.msrc_dss_tcc_us, pre_pclks);
+	ret = regmap_write(s->regmap, VL53L0X_MSRC_CONFIG_TIMEOUT_MACROP,
+			   mclks > 256 ? 255 : mclks - 1);
+	if (ret)
+		return ret;
+
+	cfg = final_cfg[(final_pclks - 8) / 2];
+	ret = regmap_write(s->regmap, VL53L0X_FINAL_RANGE_VALID_PHASE_HIGH, cfg[0]);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_FINAL_RANGE_VALID_PHASE_LOW, 0x08);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_GLOBAL_CONFIG_VCSEL_WIDTH, cfg[1]);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_ALGO_PHASECAL_CONFIG_TIMEOUT, cfg[2]);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, 0xFF, 0x01);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_ALGO_PHASECAL_LIM, cfg[3]);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, 0xFF, 0x00);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_FINAL_RANGE_CONFIG_VCSEL_PERIOD,
+			   (final_pclks >> 1) - 1);
+	if (ret)
+		return ret;
+
+	s->pre_vcsel = pre_pclks;
+	s->final_vcsel = final_pclks;
+	return 0;
+}
+
+/*
+ * Runtime config change (buffer off): limit, VCSEL periods and budget. Phase
+ * calibration depends on the VCSEL period, so a new period runs it again.
+ */
+static int vl53l0x_configure(struct vl53l0x_sensor *s, u32 budget_us, u8 pre_pclks,
+			     u8 final_pclks, u16 signal_limit)
+{
+	bool vcsel = pre_pclks != s->pre_vcsel || final_pclks != s->final_vcsel;
+	int ret;
+
+	if (signal_limit != s->signal_limit) {
+		ret = vl53l0x_write16(s, VL53L0X_FINAL_RANGE_MIN_COUNT_RATE, signal_limit);
+		if (ret)
+			return ret;
+		s->signal_limit = signal_limit;
+	}
+	if (vcsel) {
+		ret = vl53l0x_write_vcsel(s, pre_pclks, final_pclks);
+		if (ret)
+			return ret;
+	}
+	ret = vl53l0x_set_budget(s, budget_us);
+	if (ret || !vcsel)
+		return ret;
+	ret = vl53l0x_single_ref_cal(s, VL53L0X_SEQ_PHASE_CAL, 0x00);
+	if (ret)
+		return ret;
+	ret = vl53l0x_ref_cal_io(s, true);
+	if (ret)
+		return ret;
+	return regmap_write(s->regmap, VL53L0X_SYSTEM_SEQUENCE_CONFIG, VL53L0X_SEQ_DEFAULT);
+}
+
+/* DataInit + StaticInit + ref calibration; caller holds data->lock */
+static int vl53l0x_hw_init(struct vl53l0x_sensor *s)
+{
+	static const struct reg_sequence stop_enter[] = {
+		{ 0x88, 0x00 }, { 0x80, 0x01 }, { 0xFF, 0x01 }, { 0x00, 0x00 },
+	};
+	static const struct reg_sequence stop_leave[] = {
+		{ 0x00, 0x01 }, { 0xFF, 0x00 }, { 0x80, 0x00 },
+	};
+	unsigned int val;
+	u8 spad_count;
+	bool spad_aperture;
+	int ret;
+
+	ret = regmap_read(s->regmap, VL53L0X_IDENTIFICATION_MODEL_ID, &val);
+	if (ret)
+		return ret;
+	if (val != VL53L0X_MODEL_ID)
+		return -ENODEV;
+
+	/* 2V8 I/O (all common breakout boards) */
+	ret = regmap_update_bits(s->regmap, VL53L0X_VHV_CONFIG_PAD_SCL_SDA_EXTSUP_HV,
+				 0x01, 0x01);
+	if (ret)
+		return ret;
+
+	/* I2C standard mode, read the stop variable */
+	ret = regmap_multi_reg_write(s->regmap, stop_enter, ARRAY_SIZE(stop_enter));
+	if (ret)
+		return ret;
+	ret = regmap_read(s->regmap, 0x91, &val);
+	if (ret)
+		return ret;
+	s->stop_variable = val;
+	ret = regmap_multi_reg_write(s->regmap, stop_leave, ARRAY_SIZE(stop_leave));
+	if (ret)
+		return ret;
+
+	/* Disable the MSRC and pre-range signal rate limit checks */
+	ret = regmap_update_bits(s->regmap, VL53L0X_MSRC_CONFIG_CONTROL, 0x12, 0x12);
+	if (ret)
+		return ret;
+	/* Final range signal rate limit (Q9.7) */
+	ret = vl53l0x_write16(s, VL53L0X_FINAL_RANGE_MIN_COUNT_RATE, s->signal_limit);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_SYSTEM_SEQUENCE_CONFIG, 0xFF);
+	if (ret)
+		return ret;
+
+	if (s->cal_valid) {
+		ret = vl53l0x_restore_ref_spads(s);
+	} else {
+		ret = vl53l0x_get_spad_info(s, &spad_count, &spad_aperture);
+		if (ret)
+			return ret;
+		ret = vl53l0x_set_ref_spads(s, spad_count, spad_aperture);
+	}
+	if (ret)
+		return ret;
+
+	ret = regmap_multi_reg_write(s->regmap, vl53l0x_tuning, ARRAY_SIZE(vl53l0x_tuning));
+	if (ret)
+		return ret;
+
+	/* GPIO1: new sample ready, active low */
+	ret = regmap_write(s->regmap, VL53L0X_SYSTEM_INTERRUPT_CONFIG_GPIO, 0x04);
+	if (ret)
+		return ret;
+	ret = regmap_update_bits(s->regmap, VL53L0X_GPIO_HV_MUX_ACTIVE_HIGH, 0x10, 0x00);
+	if (ret)
+		return ret;
+	ret = regmap_write(s->regmap, VL53L0X_SYSTEM_INTERRUPT_CLEAR, 0x01);
+	if (ret)
+		return ret;
+
+	ret = regmap_write(s->regmap, VL53L0X_SYSTEM_SEQUENCE_CONFIG, VL53L0X_SEQ_DEFAULT);
+	if (ret)
+		return ret;
+	/* the tuning table leaves 14/10 PCLKs */
+	if (s->pre_vcsel != 14 || s->final_vcsel != 10) {
+		u8 pre = s->pre_vcsel, final = s->final_vcsel;
+
+		s->pre_vcsel = 14;
+		s->final_vcsel = 10;
+		ret = vl53l0x_write_vcsel(s, pre, final);
+		if (ret)
+			return ret;
+	}
+	ret = vl53l0x_set_budget(s, s->budget_us);
+	if (ret)
+		return ret;
+
+	if (s->cal_valid) {
+		/* stored VHV/phase results instead of two reference measurements */
+		ret = vl53l0x_ref_cal_io(s, false);
+		if (ret)
+			return ret;
+	} else {
+		ret = vl53l0x_single_ref_cal(s, VL53L0X_SEQ_VHV_CAL, 0x40);
+		if (ret)
+			return ret;
+		ret = vl53l0x_single_ref_cal(s, VL53L0X_SEQ_PHASE_CAL, 0x00);
+		if (ret)
+			return ret;
+		ret = vl53l0x_ref_cal_io(s, true);
+		if (ret)
+			return ret;
+		s->cal.version = VL53L0X_CAL_VERSION;
+		s->cal_valid = true;
+	}
+	return regmap_write(s->regmap, VL53L0X_SYSTEM_SEQUENCE_CONFIG, VL53L0X_SEQ_DEFAULT);
+}
+
+static int vl53l0x_start_continuous(struct vl53l0x_sensor *s)
+{
+	int ret = vl53l0x_unlock_stop(s);
+	if (ret)
+		return ret;
+	return regmap_write(s->regmap, VL53L0X_SYSRANGE_START, VL53L0X_MODE_BACK_TO_BACK);
+}
+
+/* Stop-variable sequence and single-shot start in one register sequence */
+static int vl53l0x_start_single(struct vl53l0x_sensor *s)
+{
+	const struct reg_sequence seq[] = {
+		{ 0x80, 0x01 }, { 0xFF, 0x01 }, { 0x00, 0x00 },
+		{ 0x91, s->stop_variable },
+		{ 0x00, 0x01 }, { 0xFF, 0x00 }, { 0x80, 0x00 },
+		{ VL53L0X_SYSRANGE_START, VL53L0X_MODE_SINGLESHOT },
+	};
+
+	return regmap_multi_reg_write(s->regmap, seq, ARRAY_SIZE(seq));
+}
+
+static int vl53l0x_stop_continuous(struct vl53l0x_sensor *s)
+{
+	static const struct reg_sequence seq[] = {
+		{ VL53L0X_SYSRANGE_START, VL53L0X_MODE_SINGLESHOT },
+		{ 0xFF, 0x01 }, { 0x00, 0x00 }, { 0x91, 0x00 },
+		{ 0x00, 0x01 }, { 0xFF, 0x00 },
+	};
+
+	return regmap_multi_reg_write(s->regmap, seq, ARRAY_SIZE(seq));
+}
+
+/*
+ * Reads interrupt status and range in one transfer. Returns -EAGAIN if no
+ * new measurement is ready, otherwise clears the interrupt.
+ */
+static int vl53l0x_read_result(struct vl53l0x_sensor *s, u16 *range)
+{
+	u8 buf[VL53L0X_RESULT_LEN];
+	int ret;
+
+	ret = regmap_bulk_read(s->regmap, VL53L0X_RESULT_INTERRUPT_STATUS, buf, sizeof(buf));
+	if (ret)
+		return ret;
+	if (!(buf[0] & 0x07)) {
+		atomic64_inc(&s->stats->not_ready);
+		return -EAGAIN;
+	}
+	*range = get_unaligned_be16(&buf[VL53L0X_RESULT_RANGE_OFF]);
+	return regmap_write(s->regmap, VL53L0X_SYSTEM_INTERRUPT_CLEAR, 0x01);
+}
+
+/*
+ * Ranging profiles after ST's examples. Signal limit in MCPS Q9.7 (0.25 = 32,
+ * 0.1 ~ 13); long range widens the VCSEL pulses to see weaker returns.
+ * Probe starts in high-speed (50 Hz back-to-back). Writing integration_time
+ * or sampling_frequency keeps the VCSEL periods and signal limit of the last
+ * profile and reports "custom", which cannot itself be selected.
+ */
+struct vl53l0x_profile {
+	u32 budget_us;
+	u8 pre_vcsel, final_vcsel;
+	u16 signal_limit;
+};
+
+enum { VL53L0X_PROFILE_DEFAULT, VL53L0X_PROFILE_HIGH_SPEED,
+       VL53L0X_PROFILE_HIGH_ACCURACY, VL53L0X_PROFILE_LONG_RANGE,
+       VL53L0X_PROFILE_CUSTOM };
+
+static const char * const vl53l0x_profile_names[] = {
+	[VL53L0X_PROFILE_DEFAULT] = "default",
+	[VL53L0X_PROFILE_HIGH_SPEED] = "high-speed",
+	[VL53L0X_PROFILE_HIGH_ACCURACY] = "high-accuracy",
+	[VL53L0X_PROFILE_LONG_RANGE] = "long-range",
+	[VL53L0X_PROFILE_CUSTOM] = "custom",
+};
+
+static const struct vl53l0x_profile vl53l0x_profiles[] = {
+	[VL53L0X_PROFILE_DEFAULT] = { 33000, 14, 10, 32 },
+	[VL53L0X_PROFILE_HIGH_SPEED] = { 20000, 14, 10, 32 },
+	[VL53L0X_PROFILE_HIGH_ACCURACY] = { 200000, 14, 10, 32 },
+	[VL53L0X_PROFILE_LONG_RANGE] = { 33000, 18, 14, 13 },
+};
+
+static void vl53l0x_sensor_defaults(struct vl53l0x_sensor *s)
+{
+	const struct vl53l0x_profile *p = &vl53l0x_profiles[VL53L0X_PROFILE_HIGH_SPEED];
+
+	s->budget_us = p->budget_us;
+	s->pre_vcsel = p->pre_vcsel;
+	s->final_vcsel = p->final_vcsel;
+	s->signal_limit = p->signal_limit;
+}
+
+/* Structure check of a calibration entry from DT or userspace */
+static int vl53l0x_cal_check(const struct vl53l0x_cal *cal)
+{
+	unsigned int i, count = 0;
+
+	if (cal->version != VL53L0X_CAL_VERSION || cal->spad_aperture > 1 ||
+	    cal->phase_cal > 0x7F)
+		return -EINVAL;
+	for (i = 0; i < ARRAY_SIZE(cal->ref_spad_map); i++)
+		count += hweight8(cal->ref_spad_map[i]);
+	if (!count || count != cal->spad_count)
+		return -EINVAL;
+	return 0;
+}
+
+/* Optional "calibration-data" of the sensor's node; a bad one is ignored */
+static void vl53l0x_cal_from_fwnode(struct device *dev, struct fwnode_handle *fwnode,
+				    struct vl53l0x_sensor *s)
+{
+	if (fwnode_property_read_u8_array(fwnode, "calibration-data", (u8 *)&s->cal,
+					  sizeof(s->cal)))
+		return;
+	if (vl53l0x_cal_check(&s->cal)) {
+		dev_warn(dev, "ignoring invalid calibration-data at 0x%02x\n", s->addr);
+		memset(&s->cal, 0, sizeof(s->cal));
+		return;
+	}
+	s->cal_valid = true;
+}
+
+/*
+ * Release XSHUT and initialize the part; in an array it first comes up at
+ * the shared boot address and is moved to its own. Caller holds data->lock.
+ */
+static int vl53l0x_sensor_bringup(struct vl53l0x_data *data, struct vl53l0x_sensor *s)
+{
+	int ret;
+	if (s->xshutdown) {
+		gpiod_set_value_cansleep(s->xshutdown, 0);
+		usleep_range(1000, 2000); /* boot time, 1.2 ms max */
+	}
+	if (data->array) {
+		ret = regmap_write(data->regmap, VL53L0X_I2C_SLAVE_DEVICE_ADDRESS, s->addr);
+		if (ret)
+			return ret;
+	}
+	return vl53l0x_hw_init(s);
+}
+
+/* sensor the register access attributes operate on */
+static struct vl53l0x_sensor *vl53l0x_sel(struct vl53l0x_data *data)
+{
+	return &data->sensors[data->reg_sensor];
+}
+
+/*
+ * Raw writes may select another register page. The cache only describes
+ * page 0, so it is bypassed until PAGE_SELECT is written back to 0.
+ */
+static int vl53l0x_raw_write(struct vl53l0x_sensor *s, unsigned int reg,
+			     const u8 *val, size_t len)
+{
+	int ret = regmap_bulk_write(s->regmap, reg, val, len);
+	if (ret || reg + len <= VL53L0X_PAGE_SELECT)
+		return ret;
+	s->paged = val[VL53L0X_PAGE_SELECT - reg] != 0;
+	regcache_cache_bypass(s->regmap, s->paged);
+	return 0;
+}
+
+/*
+ * Raw reads: all-cached spans come from the cache; a span with volatile
+ * registers is read in one transfer rather than register by register.
+ */
+static int vl53l0x_raw_read(struct vl53l0x_sensor *s, unsigned int reg,
+			    u8 *val, size_t len)
+{
+	unsigned int i;
+	int ret;
+	for (i = reg; i < reg + len; i++)
+		if (regmap_check_range_table(s->regmap, i, &vl53l0x_volatile_table))
+			break;
+	if (i == reg + len || s->paged)
+		return regmap_bulk_read(s->regmap, reg, val, len);
+	regcache_cache_bypass(s->regmap, true);
+	ret = regmap_bulk_read(s->regmap, reg, val, len);
+	regcache_cache_bypass(s->regmap, false);
+	return ret;
+}
+
+static ssize_t reg_sensor_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct vl53l0x_data *data = dev_get_drvdata(dev);
+	return sysfs_emit(buf, "%u\n", data->reg_sensor);
+}
+
+static ssize_t reg_sensor_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct vl53l0x_data *data = dev_get_drvdata(dev);
+	unsigned int idx;
+	if (kstrtouint(buf, 0, &idx))
+		return -EINVAL;
+	if (idx >= data->num_sensors)
+		return -EINVAL;
+	mutex_lock(&data->lock);
+	data->reg_sensor = idx;
+	mutex_unlock(&data->lock);
+	return count;
+}
+static DEVICE_ATTR_RW(reg_sensor);
+
 static ssize_t reg_addr_show(struct device *dev,
 			     struct device_attribute *attr, char *buf)
 {
 	struct vl53l0x_data *data = dev_get_drvdata(dev);
-	return sysfs_emit(buf, "0x%04x\n", data->reg_addr);
+	return sysfs_emit(buf, "0x%02x\n", data->reg_addr);
 }
 
 static ssize_t reg_addr_store(struct device *dev,
@@ -38,7 +1176,7 @@ static ssize_t reg_addr_store(struct device *dev,
 	unsigned int addr;
 	if (kstrtouint(buf, 0, &addr))
 		return -EINVAL;
-	if (addr > 0xFFFF)
+	if (addr > 0xFF)
 		return -EINVAL;
 	data->reg_addr = (u16)addr;
 	return count;
@@ -50,7 +1188,10 @@ static ssize_t reg_val_show(struct device *dev,
 {
 	struct vl53l0x_data *data = dev_get_drvdata(dev);
 	unsigned int val;
-	int ret = regmap_read(data->regmap, data->reg_addr, &val);
+	int ret;
+	vl53l0x_lock(data, VL53L0X_OP_RAW);
+	ret = regmap_read(vl53l0x_sel(data)->regmap, data->reg_addr, &val);
+	vl53l0x_unlock(data);
 	if (ret)
 		return ret;
 	return sysfs_emit(buf, "0x%02x\n", val & 0xFF);
@@ -62,11 +1203,17 @@ static ssize_t reg_val_store(struct device *dev,
 {
 	struct vl53l0x_data *data = dev_get_drvdata(dev);
 	unsigned int val;
+	u8 v;
+	int ret;
 	if (kstrtouint(buf, 0, &val))
 		return -EINVAL;
 	if (val > 0xFF)
 		return -EINVAL;
-	if (regmap_write(data->regmap, data->reg_addr, (u8)val))
+	v = val;
+	vl53l0x_lock(data, VL53L0X_OP_RAW);
+	ret = vl53l0x_raw_write(vl53l0x_sel(data), data->reg_addr, &v, 1);
+	vl53l0x_unlock(data);
+	if (ret)
 		return -EIO;
 	return count;
 }
@@ -76,11 +1223,12 @@ static ssize_t xshut_show(struct device *dev,
 			  struct device_attribute *attr, char *buf)
 {
 	struct vl53l0x_data *data = dev_get_drvdata(dev);
+	struct gpio_desc *xshutdown = vl53l0x_sel(data)->xshutdown;
 	int active;
-	if (!data->xshutdown)
+	if (!xshutdown)
 		return sysfs_emit(buf, "-1\n");
 	/* gpiod_get_value returns logical value: 1 == active (asserted), 0 == inactive (released) */
-	active = gpiod_get_value_cansleep(data->xshutdown);
+	active = gpiod_get_value_cansleep(xshutdown);
 	if (active < 0)
 		return active;
 	return sysfs_emit(buf, "%d\n", active ? 0 : 1);
@@ -91,20 +1239,270 @@ static ssize_t xshut_store(struct device *dev,
 			   const char *buf, size_t count)
 {
 	struct vl53l0x_data *data = dev_get_drvdata(dev);
+	struct iio_dev *indio_dev = iio_priv_to_dev(data);
+	struct vl53l0x_sensor *s;
 	unsigned long v;
-	if (!data->xshutdown)
-		return -ENODEV;
+	int ret = 0;
 	if (kstrtoul(buf, 0, &v))
 		return -EINVAL;
-	/* write 1 to release (inactive), 0 to assert reset (active) */
-	gpiod_set_value_cansleep(data->xshutdown, v ? 0 : 1);
-	if (v) /* give sensor time to boot when releasing reset */
-		usleep_range(1000, 2000);
-	return count;
+	/* the sensor loses its whole configuration in reset: not while ranging */
+	if (!iio_device_claim_direct(indio_dev))
+		return -EBUSY;
+	mutex_lock(&data->lock);
+	s = vl53l0x_sel(data);
+	if (!s->xshutdown) {
+		ret = -ENODEV;
+	} else if (v) {
+		/*
+		 * write 1 to release (inactive): boot, re-address, re-init, then
+		 * put back the cached configuration, including writes made while
+		 * the part was in reset
+		 */
+		if (data->irq)
+			disable_irq(data->irq);
+		regcache_cache_only(s->regmap, false);
+		regcache_cache_bypass(s->regmap, true);
+		ret = vl53l0x_sensor_bringup(data, s);
+		regcache_cache_bypass(s->regmap, false);
+		if (!ret)
+			ret = regcache_sync(s->regmap);
+		if (data->irq)
+			enable_irq(data->irq);
+	} else {
+		/* 0 to assert reset (active): config writes now go to the cache */
+		gpiod_set_value_cansleep(s->xshutdown, 1);
+		s->paged = false;
+		regcache_cache_bypass(s->regmap, false);
+		regcache_cache_only(s->regmap, true);
+		regcache_mark_dirty(s->regmap);
+	}
+	mutex_unlock(&data->lock);
+	iio_device_release_direct(indio_dev);
+	return ret ? ret : count;
 }
 static DEVICE_ATTR_RW(xshut);
 
+/*
+ * Binary register access (see vl53l0x.h): one syscall, one lock hold and as
+ * few bus transfers as the addresses allow, instead of two syscalls per byte.
+ */
+static ssize_t regs_read(struct file *filp, struct kobject *kobj,
+			 const struct bin_attribute *attr, char *buf,
+			 loff_t off, size_t count)
+{
+	struct vl53l0x_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+	int ret;
+	vl53l0x_lock(data, VL53L0X_OP_RAW);
+	ret = vl53l0x_raw_read(vl53l0x_sel(data), off, buf, count);
+	vl53l0x_unlock(data);
+	return ret ? ret : count;
+}
+
+static ssize_t regs_write(struct file *filp, struct kobject *kobj,
+			  const struct bin_attribute *attr, char *buf,
+			  loff_t off, size_t count)
+{
+	struct vl53l0x_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+	int ret;
+	vl53l0x_lock(data, VL53L0X_OP_RAW);
+	ret = vl53l0x_raw_write(vl53l0x_sel(data), off, buf, count);
+	vl53l0x_unlock(data);
+	return ret ? ret : count;
+}
+static BIN_ATTR_RW(regs, 256);
+
+/* Pending merged transfer of a script: WRITE data in seq_wbuf, READ into result */
+struct vl53l0x_seq_run {
+	u8 op;
+	u8 addr;
+	unsigned int len;
+};
+
+static int vl53l0x_seq_flush(struct vl53l0x_data *data, struct vl53l0x_seq_run *run)
+{
+	int ret = 0;
+	if (!run->len)
+		return 0;
+	if (run->op == VL53L0X_REG_OP_WRITE) {
+		ret = vl53l0x_raw_write(vl53l0x_sel(data), run->addr,
+					data->seq_wbuf, run->len);
+	} else {
+		ret = vl53l0x_raw_read(vl53l0x_sel(data), run->addr,
+				       data->seq_result + data->seq_result_len, run->len);
+		if (!ret)
+			data->seq_result_len += run->len;
+	}
+	run->len = 0;
+	return ret;
+}
+
+/* Structure check before anything touches the bus */
+static int vl53l0x_seq_validate(const u8 *buf, size_t count)
+{
+	size_t pos = 0, result = 0;
+	while (pos < count) {
+		const u8 *rec = buf + pos;
+		size_t dlen = 0;
+		if (count - pos < VL53L0X_REG_SEQ_HDR)
+			return -EINVAL;
+		switch (rec[0]) {
+		case VL53L0X_REG_OP_WRITE:
+			dlen = rec[2];
+			fallthrough;
+		case VL53L0X_REG_OP_READ:
+			if (!rec[2] || rec[1] + rec[2] > 0x100)
+				return -EINVAL;
+			if (rec[0] == VL53L0X_REG_OP_READ)
+				result += rec[2];
+			break;
+		case VL53L0X_REG_OP_DELAY:
+			if (rec[1])
+				return -EINVAL;
+			break;
+		case VL53L0X_REG_OP_POLL:
+			if (rec[2] != 2)
+				return -EINVAL;
+			dlen = 2;
+			break;
+		default:
+			return -EINVAL;
+		}
+		pos += VL53L0X_REG_SEQ_HDR + dlen;
+	}
+	if (pos != count || result > VL53L0X_REG_SEQ_MAX)
+		return -EINVAL;
+	return 0;
+}
+
+static ssize_t reg_seq_write(struct file *filp, struct kobject *kobj,
+			     const struct bin_attribute *attr, char *buf,
+			     loff_t off, size_t count)
+{
+	struct vl53l0x_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+	struct vl53l0x_seq_run run = { 0 };
+	unsigned int val;
+	size_t pos = 0;
+	int ret;
+	if (off)
+		return -EINVAL;
+	ret = vl53l0x_seq_validate(buf, count);
+	if (ret)
+		return ret;
+
+	vl53l0x_lock(data, VL53L0X_OP_RAW);
+	data->seq_result_len = 0;
+	while (pos < count && !ret) {
+		const u8 *rec = (const u8 *)buf + pos;
+		u8 op = rec[0], addr = rec[1], len = rec[2];
+		pos += VL53L0X_REG_SEQ_HDR;
+
+		/* extend the pending run if this record continues it */
+		if ((op == VL53L0X_REG_OP_WRITE || op == VL53L0X_REG_OP_READ) &&
+		    run.len && run.op == op && run.addr + run.len == addr) {
+			if (op == VL53L0X_REG_OP_WRITE)
+				memcpy(data->seq_wbuf + run.len, rec + VL53L0X_REG_SEQ_HDR, len);
+			run.len += len;
+			pos += op == VL53L0X_REG_OP_WRITE ? len : 0;
+			continue;
+		}
+		ret = vl53l0x_seq_flush(data, &run);
+		if (ret)
+			break;
+
+		switch (op) {
+		case VL53L0X_REG_OP_WRITE:
+			memcpy(data->seq_wbuf, rec + VL53L0X_REG_SEQ_HDR, len);
+			pos += len;
+			fallthrough;
+		case VL53L0X_REG_OP_READ:
+			run.op = op;
+			run.addr = addr;
+			run.len = len;
+			break;
+		case VL53L0X_REG_OP_DELAY:
+			msleep(len);
+			break;
+		case VL53L0X_REG_OP_POLL:
+			ret = regmap_read_poll_timeout(vl53l0x_sel(data)->regmap, addr, val,
+						       (val & rec[3]) == rec[4], 1000,
+						       VL53L0X_REG_POLL_TIMEOUT_MS * 1000);
+			pos += 2;
+			break;
+		}
+	}
+	if (!ret)
+		ret = vl53l0x_seq_flush(data, &run);
+	if (ret)
+		data->seq_result_len = 0;
+	vl53l0x_unlock(data);
+	return ret ? ret : count;
+}
+
+static ssize_t reg_seq_read(struct file *filp, struct kobject *kobj,
+			    const struct bin_attribute *attr, char *buf,
+			    loff_t off, size_t count)
+{
+	struct vl53l0x_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+	mutex_lock(&data->lock);
+	if (off >= data->seq_result_len)
+		count = 0;
+	else
+		count = min_t(size_t, count, data->seq_result_len - off);
+	memcpy(buf, data->seq_result + off, count);
+	mutex_unlock(&data->lock);
+	return count;
+}
+static BIN_ATTR_RW(reg_seq, VL53L0X_REG_SEQ_MAX);
+
+/* calibration (see vl53l0x.h): one struct vl53l0x_cal per sensor */
+static ssize_t calibration_read(struct file *filp, struct kobject *kobj,
+				const struct bin_attribute *attr, char *buf,
+				loff_t off, size_t count)
+{
+	struct vl53l0x_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+	struct vl53l0x_cal cal[VL53L0X_MAX_SENSORS] = { };
+	size_t len = data->num_sensors * sizeof(cal[0]);
+	unsigned int i;
+	mutex_lock(&data->lock);
+	for (i = 0; i < data->num_sensors; i++)
+		if (data->sensors[i].cal_valid)
+			cal[i] = data->sensors[i].cal;
+	mutex_unlock(&data->lock);
+	return memory_read_from_buffer(buf, count, &off, cal, len);
+}
+
+static ssize_t calibration_write(struct file *filp, struct kobject *kobj,
+				 const struct bin_attribute *attr, char *buf,
+				 loff_t off, size_t count)
+{
+	struct vl53l0x_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+	const struct vl53l0x_cal *cal = (const struct vl53l0x_cal *)buf;
+	unsigned int i;
+	if (off || count != data->num_sensors * sizeof(*cal))
+		return -EINVAL;
+	for (i = 0; i < data->num_sensors; i++)
+		if (cal[i].version && vl53l0x_cal_check(&cal[i]))
+			return -EINVAL;
+
+	mutex_lock(&data->lock);
+	for (i = 0; i < data->num_sensors; i++) {
+		data->sensors[i].cal = cal[i];
+		data->sensors[i].cal_valid = cal[i].version;
+	}
+	mutex_unlock(&data->lock);
+	return count;
+}
+static BIN_ATTR_RW(calibration, VL53L0X_MAX_SENSORS * sizeof(struct vl53l0x_cal));
+
+static const struct bin_attribute *const vl53l0x_bin_attrs[] = {
+	&bin_attr_regs,
+	&bin_attr_reg_seq,
+	&bin_attr_calibration,
+	NULL,
+};
+
 static struct attribute *vl53l0x_attrs[] = {
+	&dev_attr_reg_sensor.attr,
 	&dev_attr_reg_addr.attr,
 	&dev_attr_reg_val.attr,
 	&dev_attr_xshut.attr,
@@ -113,54 +1511,744 @@ static struct attribute *vl53l0x_attrs[] = {
 
 static const struct attribute_group vl53l0x_attr_group = {
 	.attrs = vl53l0x_attrs,
+	.bin_attrs = vl53l0x_bin_attrs,
 };
 
-static int vl53l0x_probe(struct i2c_client *client)
+/*
+ * IIO: distance in mm, one indexed channel per sensor in an array
+ */
+
+/* Array cycle: the slowest sensor's budget plus single-shot slack */
+static u32 vl53l0x_array_cycle_us(struct vl53l0x_data *data)
 {
-	struct vl53l0x_data *data;
+	u32 budget = 0;
+	unsigned int i;
+
+	for (i = 0; i < data->num_sensors; i++)
+		budget = max(budget, data->sensors[i].budget_us);
+	return budget + VL53L0X_ARRAY_MARGIN_US;
+}
+
+/* Output period: back-to-back runs at the budget, an array at its cycle */
+static u32 vl53l0x_period_us(struct vl53l0x_data *data)
+{
+	return data->array ? vl53l0x_array_cycle_us(data) : data->sensors[0].budget_us;
+}
+
+/* Same settings on every sensor; caller holds data->lock, buffer off */
+static int vl53l0x_configure_all(struct vl53l0x_data *data, u32 budget_us,
+				 const struct vl53l0x_profile *p)
+{
+	unsigned int i;
+	int ret;
+
+	if (budget_us < VL53L0X_BUDGET_MIN_US || budget_us > VL53L0X_BUDGET_MAX_US)
+		return -EINVAL;
+	for (i = 0; i < data->num_sensors; i++) {
+		ret = vl53l0x_configure(&data->sensors[i], budget_us, p->pre_vcsel,
+					p->final_vcsel, p->signal_limit);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int vl53l0x_get_profile(struct iio_dev *indio_dev,
+			       const struct iio_chan_spec *chan)
+{
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+
+	return data->custom ? VL53L0X_PROFILE_CUSTOM : data->profile;
+}
+
+/* profile sets budget, VCSEL periods and signal limit at once */
+static int vl53l0x_set_profile(struct iio_dev *indio_dev,
+			       const struct iio_chan_spec *chan, unsigned int idx)
+{
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+	const struct vl53l0x_profile *p;
+	int ret;
+
+	if (idx >= ARRAY_SIZE(vl53l0x_profiles))
+		return -EINVAL;
+	p = &vl53l0x_profiles[idx];
+	if (!iio_device_claim_direct(indio_dev))
+		return -EBUSY;
+	mutex_lock(&data->lock);
+	ret = vl53l0x_configure_all(data, p->budget_us, p);
+	if (!ret) {
+		data->profile = idx;
+		data->custom = false;
+	}
+	mutex_unlock(&data->lock);
+	iio_device_release_direct(indio_dev);
+	return ret;
+}
+
+static const struct iio_enum vl53l0x_profile_enum = {
+	.items = vl53l0x_profile_names,
+	.num_items = ARRAY_SIZE(vl53l0x_profile_names),
+	.get = vl53l0x_get_profile,
+	.set = vl53l0x_set_profile,
+};
+
+static const struct iio_chan_spec_ext_info vl53l0x_ext_info[] = {
+	IIO_ENUM("profile", IIO_SHARED_BY_ALL, &vl53l0x_profile_enum),
+	IIO_ENUM_AVAILABLE("profile", IIO_SHARED_BY_ALL, &vl53l0x_profile_enum),
+	{ }
+};
+
+/* integration_time = timing budget */
+static const int vl53l0x_budget_avail[] = {
+	0, 20000, 0, 33000, 0, 50000, 0, 100000, 0, 200000,
+};
+
+static const struct iio_chan_spec vl53l0x_channels[] = {
+	{
+		.type = IIO_DISTANCE,
+		.info_mask_separate = BIT(IIO_CHAN_INFO_RAW) |
+				      BIT(IIO_CHAN_INFO_SCALE),
+		.info_mask_shared_by_all = BIT(IIO_CHAN_INFO_SAMP_FREQ) |
+					   BIT(IIO_CHAN_INFO_INT_TIME),
+		.info_mask_shared_by_all_available = BIT(IIO_CHAN_INFO_SAMP_FREQ) |
+						     BIT(IIO_CHAN_INFO_INT_TIME),
+		.ext_info = vl53l0x_ext_info,
+		.scan_index = 0,
+		.scan_type = {
+			.sign = 'u',
+			.realbits = 16,
+			.storagebits = 16,
+			.endianness = IIO_CPU,
+		},
+	},
+	IIO_CHAN_SOFT_TIMESTAMP(1),
+};
+
+/* A result was read: latency since the IRQ (or request, or poll) at @since */
+static void vl53l0x_sample_done(struct vl53l0x_data *data, struct vl53l0x_sensor *s,
+				u16 range, s64 since)
+{
+	s64 lat = iio_get_time_ns(iio_priv_to_dev(data)) - since;
+	u64 us = div_u64(max_t(s64, lat, 0), NSEC_PER_USEC);
+	unsigned int b;
+
+	b = us ? min_t(unsigned int, ilog2(us) + 1, VL53L0X_LAT_BUCKETS - 1) : 0;
+	atomic64_inc(&data->stats.samples);
+	atomic64_inc(&data->stats.lat[b]);
+	trace_vl53l0x_sample(s->addr, range, lat);
+}
+
+/* One single-shot measurement (buffer off) */
+static int vl53l0x_measure(struct vl53l0x_data *data, struct vl53l0x_sensor *s, u16 *range)
+{
+	s64 t0 = iio_get_time_ns(iio_priv_to_dev(data));
+	unsigned int val;
+	u32 timeout_us;
+	int ret;
+
+	vl53l0x_lock(data, VL53L0X_OP_SAMPLE);
+	/* a shot takes one timing budget (up to 1 s), plus the usual slack */
+	timeout_us = s->budget_us + VL53L0X_TIMEOUT_US;
+	reinit_completion(&data->done);
+	WRITE_ONCE(data->measuring, true);
+	ret = vl53l0x_start_single(s);
+	if (ret)
+		goto out;
+	/* the start bit self-clears once the measurement has begun */
+	ret = regmap_read_poll_timeout(s->regmap, VL53L0X_SYSRANGE_START, val,
+				       !(val & VL53L0X_MODE_SINGLESHOT), 1000,
+				       VL53L0X_TIMEOUT_US);
+	if (ret)
+		goto out;
+
+	if (data->irq) {
+		if (!wait_for_completion_timeout(&data->done,
+						 usecs_to_jiffies(timeout_us))) {
+			ret = -ETIMEDOUT;
+			goto out;
+		}
+		ret = data->done_ret;
+		*range = data->scan.range[0];
+	} else {
+		int err = read_poll_timeout(vl53l0x_read_result, ret, ret != -EAGAIN,
+					    s->budget_us / 4, timeout_us,
+					    false, s, range);
+		if (err)
+			ret = err;
+	}
+	if (!ret)
+		vl53l0x_sample_done(data, s, *range, t0);
+out:
+	WRITE_ONCE(data->measuring, false);
+	vl53l0x_unlock(data);
+	return ret;
+}
+
+static int vl53l0x_read_raw(struct iio_dev *indio_dev,
+			    const struct iio_chan_spec *chan,
+			    int *val, int *val2, long mask)
+{
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+	u16 range;
+	int ret;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_RAW:
+		if (!iio_device_claim_direct(indio_dev))
+			return -EBUSY;
+		ret = vl53l0x_measure(data, &data->sensors[chan->channel], &range);
+		iio_device_release_direct(indio_dev);
+		if (ret)
+			return ret;
+		*val = range;
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_SCALE:
+		*val = 0;
+		*val2 = 1000; /* mm -> m */
+		return IIO_VAL_INT_PLUS_MICRO;
+	case IIO_CHAN_INFO_INT_TIME:
+		*val = data->sensors[0].budget_us / USEC_PER_SEC;
+		*val2 = data->sensors[0].budget_us % USEC_PER_SEC;
+		return IIO_VAL_INT_PLUS_MICRO;
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		*val = USEC_PER_SEC;
+		*val2 = vl53l0x_period_us(data);
+		return IIO_VAL_FRACTIONAL;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int vl53l0x_read_avail(struct iio_dev *indio_dev,
+			      const struct iio_chan_spec *chan,
+			      const int **vals, int *type, int *length, long mask)
+{
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+
+	switch (mask) {
+	case IIO_CHAN_INFO_INT_TIME:
+		*vals = vl53l0x_budget_avail;
+		*length = ARRAY_SIZE(vl53l0x_budget_avail);
+		*type = IIO_VAL_INT_PLUS_MICRO;
+		return IIO_AVAIL_LIST;
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		*vals = data->freq_avail;
+		*length = ARRAY_SIZE(data->freq_avail);
+		*type = IIO_VAL_INT_PLUS_MICRO;
+		return IIO_AVAIL_LIST;
+	default:
+		return -EINVAL;
+	}
+}
+
+/* sampling_frequency picks the budget that gives that output rate */
+static int vl53l0x_write_raw(struct iio_dev *indio_dev,
+			     const struct iio_chan_spec *chan,
+			     int val, int val2, long mask)
+{
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+	u64 micro = (u64)val * USEC_PER_SEC + val2; /* us, or uHz */
+	u64 budget_us;
 	int ret;
 
-	data = devm_kzalloc(&client->dev, sizeof(*data), GFP_KERNEL);
-	if (!data)
+	if (val < 0 || val2 < 0)
+		return -EINVAL;
+	switch (mask) {
+	case IIO_CHAN_INFO_INT_TIME:
+		budget_us = micro;
+		break;
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		if (!micro)
+			return -EINVAL;
+		budget_us = div64_u64((u64)USEC_PER_SEC * USEC_PER_SEC, micro);
+		if (data->array)
+			budget_us -= min_t(u64, budget_us, VL53L0X_ARRAY_MARGIN_US);
+		break;
+	default:
+		return -EINVAL;
+	}
+	/* before it is narrowed to u32; configure_all checks the minimum */
+	if (budget_us > VL53L0X_BUDGET_MAX_US)
+		return -EINVAL;
+
+	if (!iio_device_claim_direct(indio_dev))
+		return -EBUSY;
+	mutex_lock(&data->lock);
+	ret = vl53l0x_configure_all(data, budget_us, &vl53l0x_profiles[data->profile]);
+	if (!ret)
+		data->custom = true;
+	mutex_unlock(&data->lock);
+	iio_device_release_direct(indio_dev);
+	return ret;
+}
+
+/* sampling_frequency_available for the budgets in integration_time_available */
+static void vl53l0x_init_freq_avail(struct vl53l0x_data *data)
+{
+	u32 period_us;
+	unsigned int i;
+	u64 uhz;
+
+	for (i = 0; i < ARRAY_SIZE(data->freq_avail) / 2; i++) {
+		period_us = vl53l0x_budget_avail[2 * i + 1] +
+			    (data->array ? VL53L0X_ARRAY_MARGIN_US : 0);
+		uhz = div_u64((u64)USEC_PER_SEC * USEC_PER_SEC, period_us);
+		data->freq_avail[2 * i] = div_u64_rem(uhz, USEC_PER_SEC,
+						      (u32 *)&data->freq_avail[2 * i + 1]);
+	}
+}
+
+/* buffered samples come from the sensor's own data-ready, nothing else */
+static const struct iio_info vl53l0x_info = {
+	.read_raw = vl53l0x_read_raw,
+	.read_avail = vl53l0x_read_avail,
+	.write_raw = vl53l0x_write_raw,
+	.validate_trigger = iio_validate_own_trigger,
+};
+
+/*
+ * GPIO1 is level-low until SYSTEM_INTERRUPT_CLEAR: timestamp in the hard
+ * half, read and clear in the (oneshot) thread. The trigger then runs nested
+ * in this thread, so no second context switch per sample.
+ */
+static irqreturn_t vl53l0x_irq(int irq, void *p)
+{
+	struct iio_dev *indio_dev = p;
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+
+	data->irq_ts = iio_get_time_ns(indio_dev);
+	return IRQ_WAKE_THREAD;
+}
+
+static irqreturn_t vl53l0x_irq_thread(int irq, void *p)
+{
+	struct iio_dev *indio_dev = p;
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+	struct vl53l0x_sensor *s = &data->sensors[0];
+	int ret;
+
+	if (!iio_buffer_enabled(indio_dev)) {
+		/*
+		 * Nobody waiting (timed-out shot, stray edge): just clear it.
+		 * Never block on the lock for that: a vl53l0x_measure() that
+		 * got it first would wait for an IRQ this masked line cannot
+		 * deliver. If the holder turns out to be measuring, take its
+		 * result instead.
+		 */
+		while (!READ_ONCE(data->measuring)) {
+			if (vl53l0x_trylock(data, VL53L0X_OP_SAMPLE)) {
+				ret = regmap_write(s->regmap, VL53L0X_SYSTEM_INTERRUPT_CLEAR, 0x01);
+				vl53l0x_unlock(data);
+				return ret ? IRQ_NONE : IRQ_HANDLED;
+			}
+			usleep_range(500, 1000);
+		}
+		/*
+		 * single-shot: vl53l0x_measure() holds the lock while it waits,
+		 * so the bus is ours (and on page 0)
+		 */
+		data->done_ret = vl53l0x_read_result(s, &data->scan.range[0]);
+		if (data->done_ret == -EAGAIN)
+			return IRQ_NONE;
+		complete(&data->done);
+		return IRQ_HANDLED;
+	}
+
+	vl53l0x_lock(data, VL53L0X_OP_SAMPLE);
+	ret = vl53l0x_read_result(s, &data->scan.range[0]);
+	vl53l0x_unlock(data);
+	if (ret)
+		return ret == -EAGAIN ? IRQ_NONE : IRQ_HANDLED;
+	vl53l0x_sample_done(data, s, data->scan.range[0], data->irq_ts);
+
+	data->scan.ts = data->irq_ts;
+	iio_trigger_poll_nested(data->trig);
+	return IRQ_HANDLED;
+}
+
+/*
+ * Array slot: collect sensor @idx's previous shot (started one cycle ago, so
+ * normally done) and start its next one. A late result keeps the old value
+ * in the scan and is picked up next cycle. Caller holds data->lock.
+ */
+static void vl53l0x_array_slot(struct vl53l0x_data *data, unsigned int idx, s64 ts)
+{
+	struct vl53l0x_sensor *s = &data->sensors[idx];
+	int ret;
+
+	if (s->busy) {
+		ret = vl53l0x_read_result(s, &data->scan.range[idx]);
+		if (ret == -EAGAIN)
+			return;
+		if (!ret)
+			vl53l0x_sample_done(data, s, data->scan.range[idx], ts);
+		s->busy = false;
+	}
+	s->busy = !vl53l0x_start_single(s);
+}
+
+static irqreturn_t vl53l0x_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+	int ret = 0;
+
+	if (data->array) {
+		vl53l0x_lock(data, VL53L0X_OP_SAMPLE);
+		vl53l0x_array_slot(data, data->slot, pf->timestamp);
+		vl53l0x_unlock(data);
+		/* one combined scan per cycle, after every sensor had a result */
+		if (++data->slot < data->num_sensors) {
+			ret = -EAGAIN;
+		} else {
+			data->slot = 0;
+			ret = data->primed ? 0 : -EAGAIN;
+			data->primed = true;
+		}
+		data->scan.ts = pf->timestamp;
+	} else if (!data->irq) {
+		/* polled: nothing is pushed until a new result is ready */
+		vl53l0x_lock(data, VL53L0X_OP_SAMPLE);
+		ret = vl53l0x_read_result(&data->sensors[0], &data->scan.range[0]);
+		vl53l0x_unlock(data);
+		if (!ret)
+			vl53l0x_sample_done(data, &data->sensors[0], data->scan.range[0],
+					    pf->timestamp);
+		data->scan.ts = pf->timestamp;
+	}
+	if (!ret)
+		iio_push_to_buffers_with_ts(indio_dev, &data->scan, sizeof(data->scan),
+					    data->scan.ts);
+
+	iio_trigger_notify_done(indio_dev->trig);
+	return IRQ_HANDLED;
+}
+
+static enum hrtimer_restart vl53l0x_timer_fn(struct hrtimer *timer)
+{
+	struct vl53l0x_data *data = container_of(timer, struct vl53l0x_data, timer);
+
+	hrtimer_forward_now(timer, data->period);
+	iio_trigger_poll(data->trig);
+	return HRTIMER_RESTART;
+}
+
+static int vl53l0x_trigger_set_state(struct iio_trigger *trig, bool state)
+{
+	struct vl53l0x_data *data = iio_trigger_get_drvdata(trig);
+	struct vl53l0x_sensor *s;
+	unsigned int i;
+	int ret = 0;
+
+	if (!state) {
+		hrtimer_cancel(&data->timer);
+		if (data->array)
+			return 0; /* shots in flight just finish */
+		mutex_lock(&data->lock);
+		ret = vl53l0x_stop_continuous(&data->sensors[0]);
+		mutex_unlock(&data->lock);
+		return ret;
+	}
+
+	mutex_lock(&data->lock);
+	for (i = 0; i < data->num_sensors && !ret; i++) {
+		s = &data->sensors[i];
+		s->busy = false;
+		ret = regmap_write(s->regmap, VL53L0X_SYSTEM_INTERRUPT_CLEAR, 0x01);
+	}
+	if (!ret && !data->array)
+		ret = vl53l0x_start_continuous(&data->sensors[0]);
+	mutex_unlock(&data->lock);
+	if (ret)
+		return ret;
+
+	if (data->array) {
+		data->slot = 0;
+		data->primed = false;
+		data->period = ns_to_ktime((u64)vl53l0x_array_cycle_us(data) * NSEC_PER_USEC /
+					   data->num_sensors);
+	} else if (!data->irq) {
+		data->period = ns_to_ktime((u64)data->sensors[0].budget_us * NSEC_PER_USEC / 2);
+	} else {
+		return 0;
+	}
+	hrtimer_start(&data->timer, data->period, HRTIMER_MODE_REL);
+	return 0;
+}
+
+static const struct iio_trigger_ops vl53l0x_trigger_ops = {
+	.set_trigger_state = vl53l0x_trigger_set_state,
+	.validate_device = iio_trigger_validate_own_device,
+};
+
+static int vl53l0x_setup_trigger(struct iio_dev *indio_dev)
+{
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+	struct device *dev = &data->client->dev;
+	int irq = data->irq;
+	int ret;
+
+	data->trig = devm_iio_trigger_alloc(dev, "%s-dev%d", indio_dev->name,
+					   iio_device_id(indio_dev));
+	if (!data->trig)
 		return -ENOMEM;
+	data->trig->ops = &vl53l0x_trigger_ops;
+	iio_trigger_set_drvdata(data->trig, data);
+	hrtimer_setup(&data->timer, vl53l0x_timer_fn, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 
-	data->client = client;
+	if (irq) {
+		ret = devm_request_threaded_irq(dev, irq, vl53l0x_irq, vl53l0x_irq_thread,
+						IRQF_ONESHOT |
+						(irq_get_trigger_type(irq) ?: IRQF_TRIGGER_LOW),
+						indio_dev->name, indio_dev);
+		if (ret)
+			return dev_err_probe(dev, ret, "failed to request irq %d\n", irq);
+	} else if (!data->array) {
+		dev_info(dev, "no GPIO1 interrupt, polling for results\n");
+	}
+
+	ret = devm_iio_trigger_register(dev, data->trig);
+	if (ret)
+		return ret;
+	indio_dev->trig = iio_trigger_get(data->trig);
+
+	return devm_iio_triggered_buffer_setup(dev, indio_dev, iio_pollfunc_store_time,
+					       vl53l0x_trigger_handler, NULL);
+}
+
+/*
+ * Array (compatible "opensource,vl53l0x-array"): the node sits at the boot
+ * address and has one child per sensor with its target address in reg and
+ * its own xshutdown-gpios. All parts are held in reset, then released and
+ * re-addressed one at a time in DT order.
+ */
+static int vl53l0x_array_init(struct vl53l0x_data *data)
+{
+	struct device *dev = &data->client->dev;
+	struct vl53l0x_sensor *s;
+	struct i2c_client *dummy;
+	unsigned int i = 0;
+	u32 addr;
+	int ret;
+
+	device_for_each_child_node_scoped(dev, child) {
+		if (i == VL53L0X_MAX_SENSORS)
+			return dev_err_probe(dev, -EINVAL, "more than %d sensors\n",
+					     VL53L0X_MAX_SENSORS);
+		s = &data->sensors[i];
+		ret = fwnode_property_read_u32(child, "reg", &addr);
+		if (ret || addr > 0x7F || addr == data->client->addr)
+			return dev_err_probe(dev, -EINVAL, "sensor %u: bad address\n", i);
+		s->addr = addr;
+		s->stats = &data->stats;
+		vl53l0x_sensor_defaults(s);
+		vl53l0x_cal_from_fwnode(dev, child, s);
+		/* asserted: only one part at a time may answer at the boot address */
+		s->xshutdown = devm_fwnode_gpiod_get(dev, child, "xshutdown",
+						     GPIOD_OUT_HIGH, "vl53l0x-xshut");
+		if (IS_ERR(s->xshutdown))
+			return dev_err_probe(dev, PTR_ERR(s->xshutdown),
+					     "sensor %u: no xshutdown gpio\n", i);
+		i++;
+	}
+	if (!i)
+		return dev_err_probe(dev, -ENODEV, "no sensor nodes\n");
+	data->num_sensors = i;
+	usleep_range(1000, 2000);
+
+	for (i = 0; i < data->num_sensors; i++) {
+		s = &data->sensors[i];
+		dummy = devm_i2c_new_dummy_device(dev, data->client->adapter, s->addr);
+		if (IS_ERR(dummy))
+			return dev_err_probe(dev, PTR_ERR(dummy), "sensor %u: address 0x%02x busy\n",
+					     i, s->addr);
+		s->regmap = vl53l0x_regmap_init(data, dummy);
+		if (IS_ERR(s->regmap))
+			return PTR_ERR(s->regmap);
+		ret = vl53l0x_sensor_bringup(data, s);
+		if (ret)
+			return dev_err_probe(dev, ret, "sensor %u at 0x%02x: init failed\n",
+					     i, s->addr);
+	}
+	return 0;
+}
+
+static int vl53l0x_array_channels(struct iio_dev *indio_dev)
+{
+	struct vl53l0x_data *data = iio_priv(indio_dev);
+	unsigned int i, n = data->num_sensors;
+	struct iio_chan_spec *ch;
+
+	ch = devm_kcalloc(&data->client->dev, n + 1, sizeof(*ch), GFP_KERNEL);
+	if (!ch)
+		return -ENOMEM;
+	for (i = 0; i < n; i++) {
+		ch[i] = vl53l0x_channels[0];
+		ch[i].indexed = 1;
+		ch[i].channel = i;
+		ch[i].scan_index = i;
+	}
+	ch[n] = vl53l0x_channels[1];
+	ch[n].scan_index = n;
+
+	/* the slot scheduler always reads every sensor: one scan, demuxed by IIO */
+	data->scan_masks[0] = GENMASK(n - 1, 0);
+	indio_dev->channels = ch;
+	indio_dev->num_channels = n + 1;
+	indio_dev->available_scan_masks = data->scan_masks;
+	return 0;
+}
+
+static void vl53l0x_remove_group(void *arg)
+{
+	struct device *dev = arg;
+
+	sysfs_remove_group(&dev->kobj, &vl53l0x_attr_group);
+}
+
+static int vl53l0x_stats_show(struct seq_file *m, void *v)
+{
+	struct vl53l0x_data *data = m->private;
+	struct vl53l0x_stats *st = &data->stats;
+	u64 samples = atomic64_read(&st->samples);
+	unsigned int i;
+
+	seq_printf(m, "sensors:    %u, period %u us\n", data->num_sensors,
+		   vl53l0x_period_us(data));
+	for (i = 0; i < VL53L0X_OP_NUM; i++)
+		seq_printf(m, "%-7s     %llu xfers, %llu bytes (reg+data), %llu us\n", vl53l0x_op_names[i],
+			   (u64)atomic64_read(&st->xfers[i]), (u64)atomic64_read(&st->bytes[i]),
+			   div_u64(atomic64_read(&st->bus_ns[i]), NSEC_PER_USEC));
+	seq_printf(m, "errors:     %llu\n", (u64)atomic64_read(&st->errors));
+	seq_printf(m, "not_ready:  %llu\n", (u64)atomic64_read(&st->not_ready));
+	seq_printf(m, "samples:    %llu\n", samples);
+	if (samples)
+		seq_printf(m, "per sample: %llu xfers, %llu bytes (reg+data), %llu ns bus\n",
+			   div64_u64(atomic64_read(&st->xfers[VL53L0X_OP_SAMPLE]), samples),
+			   div64_u64(atomic64_read(&st->bytes[VL53L0X_OP_SAMPLE]), samples),
+			   div64_u64(atomic64_read(&st->bus_ns[VL53L0X_OP_SAMPLE]), samples));
 
-	/* Optional XSHUT line (active-low). Default to released (inactive). */
-	data->xshutdown = devm_gpiod_get_optional(&client->dev, "xshutdown", GPIOD_OUT_LOW);
-	if (IS_ERR(data->xshutdown))
-		return PTR_ERR(data->xshutdown);
+	seq_puts(m, "sample latency (IRQ/request -> result read):\n");
+	for (i = 0; i < VL53L0X_LAT_BUCKETS; i++) {
+		u64 cnt = atomic64_read(&st->lat[i]);
 
-	if (data->xshutdown) {
-		/* Ensure the device is out of reset */
-		gpiod_set_value_cansleep(data->xshutdown, 0);
-		usleep_range(1000, 2000);
+		if (i == 0)
+			seq_printf(m, "  %10s %llu\n", "<1us", cnt);
+		else if (i == VL53L0X_LAT_BUCKETS - 1)
+			seq_printf(m, "  >=%7uus %llu\n", 1U << (i - 1), cnt);
+		else
+			seq_printf(m, "  <%8uus %llu\n", 1U << i, cnt);
 	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vl53l0x_stats);
+
+static void vl53l0x_remove_debugfs(void *arg)
+{
+	debugfs_remove_recursive(arg);
+}
+
+static int vl53l0x_debugfs_init(struct vl53l0x_data *data)
+{
+	struct device *dev = &data->client->dev;
+	struct dentry *dir;
+	char name[32];
+
+	snprintf(name, sizeof(name), "vl53l0x-%s", dev_name(dev));
+	dir = debugfs_create_dir(name, NULL);
+	debugfs_create_file("stats", 0444, dir, data, &vl53l0x_stats_fops);
+	return devm_add_action_or_reset(dev, vl53l0x_remove_debugfs, dir);
+}
+
+static int vl53l0x_probe(struct i2c_client *client)
+{
+	struct iio_dev *indio_dev;
+	struct vl53l0x_data *data;
+	struct vl53l0x_sensor *s;
+	int ret;
+
+	indio_dev = devm_iio_device_alloc(&client->dev, sizeof(*data));
+	if (!indio_dev)
+		return -ENOMEM;
 
-	data->regmap = devm_regmap_init_i2c(client, &vl53l0x_regmap_cfg);
+	data = iio_priv(indio_dev);
+	data->client = client;
+	data->array = device_is_compatible(&client->dev, "opensource,vl53l0x-array");
+	mutex_init(&data->lock);
+	init_completion(&data->done);
+
+	data->regmap = vl53l0x_regmap_init(data, client);
 	if (IS_ERR(data->regmap))
 		return dev_err_probe(&client->dev, PTR_ERR(data->regmap), "regmap init failed\n");
 
 	/* Default sysfs register address */
-	data->reg_addr = 0x0000;
+	data->reg_addr = 0x00;
 
 	i2c_set_clientdata(client, data);
 
+	if (data->array) {
+		ret = vl53l0x_array_init(data);
+		if (ret)
+			return ret;
+		indio_dev->name = "vl53l0x-array";
+		ret = vl53l0x_array_channels(indio_dev);
+		if (ret)
+			return ret;
+	} else {
+		s = &data->sensors[0];
+		data->num_sensors = 1;
+		data->irq = client->irq;
+		s->regmap = data->regmap;
+		s->addr = client->addr;
+		s->stats = &data->stats;
+		vl53l0x_sensor_defaults(s);
+		vl53l0x_cal_from_fwnode(&client->dev, dev_fwnode(&client->dev), s);
+
+		/* Optional XSHUT line (active-low). Default to released (inactive). */
+		s->xshutdown = devm_gpiod_get_optional(&client->dev, "xshutdown", GPIOD_OUT_LOW);
+		if (IS_ERR(s->xshutdown))
+			return PTR_ERR(s->xshutdown);
+
+		ret = vl53l0x_sensor_bringup(data, s);
+		if (ret)
+			return dev_err_probe(&client->dev, ret, "ranging init failed\n");
+
+		indio_dev->name = "vl53l0x";
+		indio_dev->channels = vl53l0x_channels;
+		indio_dev->num_channels = ARRAY_SIZE(vl53l0x_channels);
+	}
+	indio_dev->info = &vl53l0x_info;
+	indio_dev->modes = INDIO_DIRECT_MODE;
+	data->profile = VL53L0X_PROFILE_HIGH_SPEED;
+	vl53l0x_init_freq_avail(data);
+
+	ret = vl53l0x_setup_trigger(indio_dev);
+	if (ret)
+		return ret;
+
 	ret = sysfs_create_group(&client->dev.kobj, &vl53l0x_attr_group);
+	if (ret)
+		return ret;
+	ret = devm_add_action_or_reset(&client->dev, vl53l0x_remove_group, &client->dev);
+	if (ret)
+		return ret;
+	ret = vl53l0x_debugfs_init(data);
 	if (ret)
 		return ret;
 
-	dev_info(&client->dev, "VL53L0X skeleton bound at 0x%02x\n", client->addr);
-	return 0;
-}
+	ret = devm_iio_device_register(&client->dev, indio_dev);
+	if (ret)
+		return ret;
 
-static void vl53l0x_remove(struct i2c_client *client)
-{
-	sysfs_remove_group(&client->dev.kobj, &vl53l0x_attr_group);
+	dev_info(&client->dev, "VL53L0X bound at 0x%02x, %u sensor(s), %u us budget\n",
+		 client->addr, data->num_sensors, data->sensors[0].budget_us);
+	return 0;
 }
 
 static const struct of_device_id vl53l0x_of_match[] = {
 	{ .compatible = "opensource,vl53l0x-simple" },
+	{ .compatible = "opensource,vl53l0x-array" },
 	{}
 };
 MODULE_DEVICE_TABLE(of, vl53l0x_of_match);
@@ -170,12 +2258,11 @@ static struct i2c_driver vl53l0x_i2c_driver = {
 		.name = "vl53l0x-simple",
 		.of_match_table = vl53l0x_of_match,
 	},
-	.probe_new = vl53l0x_probe,
-	.remove = vl53l0x_remove,
+	.probe = vl53l0x_probe,
 };
 
 module_i2c_driver(vl53l0x_i2c_driver);
 
 MODULE_AUTHOR("Your Name <you@example.com>");
-MODULE_DESCRIPTION("VL53L0X minimal I2C driver (register access + XSHUT)");
+MODULE_DESCRIPTION("VL53L0X I2C ranging driver (IIO distance + register access + XSHUT)");
 MODULE_LICENSE("GPL");
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+// Userspace ABI for the vl53l0x driver's binary sysfs files (in the I2C client
+// directory, next to reg_addr/reg_val/xshut)
+// - Shared by the kernel module and userspace tools; keep it uapi-clean
+//   (only <linux/types.h>, fixed-width __u types)
+
+#ifndef _UAPI_VL53L0X_H
+#define _UAPI_VL53L0X_H
+
+#include <linux/types.h>
+
+/*
+ * regs: the 256-byte register space as a file. pread()/pwrite() at offset
+ * = register index move len bytes with a single auto-increment I2C transfer.
+ * Page 0 configuration registers are cached by the driver: reads of those
+ * are served without bus traffic, and they are restored after an XSHUT
+ * reset. Writes to the read-only result block (0x13-0x1F) and
+ * identification (0xC0-0xC2) fail with -EIO. While a raw write leaves
+ * 0xFF (page select) non-zero, every access goes to the bus.
+ *
+ * reg_seq: scripted sequences. write() a packed list of records
+ *
+ *   +0  __u8 op      VL53L0X_REG_OP_*
+ *   +1  __u8 addr    register index
+ *   +2  __u8 len
+ *   +3  __u8 data[]  len bytes for WRITE, 2 for POLL, none otherwise
+ *
+ * of at most VL53L0X_REG_SEQ_MAX bytes, in one write() at offset 0. The
+ * whole script runs under the driver's register lock, so ranging and other
+ * register users never see it half done. Consecutive WRITE records to
+ * contiguous registers are merged into one bus transfer, and so are READ
+ * records.
+ *
+ * write() returns the script length, or an error if a record is malformed
+ * (-EINVAL, nothing run) or a transfer/poll failed (the script stops there).
+ * The bytes of all READ records, in order, can then be read() back from
+ * reg_seq at offset 0 (result of the last successful script; shared by all
+ * openers, so concurrent users have to serialize among themselves).
+ */
+#define VL53L0X_REG_OP_WRITE	0x01	/* write data[0..len) to addr.. */
+#define VL53L0X_REG_OP_READ	0x02	/* read len bytes from addr.. */
+#define VL53L0X_REG_OP_DELAY	0x03	/* sleep len ms, addr = 0 */
+#define VL53L0X_REG_OP_POLL	0x04	/* len = 2: until (reg & data[0]) == data[1] */
+
+#define VL53L0X_REG_SEQ_HDR	3
+#define VL53L0X_REG_SEQ_MAX	4096	/* script bytes, also the result limit */
+#define VL53L0X_REG_POLL_TIMEOUT_MS	500
+
+/*
+ * calibration: reference SPAD selection and VHV/phase calibration, one
+ * struct vl53l0x_cal per sensor (in DT/array order). read() returns what
+ * the sensors currently use. write() at offset 0 replaces them; they are
+ * applied by the next re-init (XSHUT release), which then skips the NVM
+ * SPAD lookup and both reference calibrations. An entry with version 0
+ * makes that sensor calibrate again.
+ *
+ * The same bytes can be given as the "calibration-data" DT property
+ * (/bits/ 8) of the sensor node, used from probe on.
+ *
+ * Phase calibration depends on the VCSEL period and is redone (and the
+ * stored value updated) when a profile changes it. VHV calibration drifts
+ * with temperature; recalibrate when the operating point moves far from
+ * where the blob was taken.
+ */
+#define VL53L0X_CAL_VERSION	1
+
+struct vl53l0x_cal {
+	__u8 version;		/* VL53L0X_CAL_VERSION */
+	__u8 spad_count;	/* enabled reference SPADs, bits set in ref_spad_map */
+	__u8 spad_aperture;	/* 1: aperture SPADs, 0: non-aperture */
+	__u8 vhv_settings;	/* register 0xCB */
+	__u8 phase_cal;		/* register 0xEE bits 6:0 */
+	__u8 ref_spad_map[6];	/* GLOBAL_CONFIG_SPAD_ENABLES_REF_0..5 */
+	__u8 __reserved;
+};
+
+#endif /* _UAPI_VL53L0X_H */
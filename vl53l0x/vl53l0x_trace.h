@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+// Tracepoints for the VL53L0X driver
+// - Enable with: echo 1 > /sys/kernel/tracing/events/vl53l0x/enable
+// - Sensors are told apart by their I2C address (arrays: one per sensor)
+// - Same event layout as my-mpu9250's (xfer, sample), so one script can
+//   budget both drivers on a shared bus
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM vl53l0x
+
+#if !defined(_VL53L0X_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _VL53L0X_TRACE_H
+
+#include <linux/tracepoint.h>
+
+/* one bus transaction: register, bytes incl. the register index, bus time */
+TRACE_EVENT(vl53l0x_xfer,
+	TP_PROTO(u16 addr, bool write, u8 reg, size_t len, u64 ns, int ret),
+	TP_ARGS(addr, write, reg, len, ns, ret),
+	TP_STRUCT__entry(
+		__field(u16, addr)
+		__field(bool, write)
+		__field(u8, reg)
+		__field(size_t, len)
+		__field(u64, ns)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		__entry->addr = addr;
+		__entry->write = write;
+		__entry->reg = reg;
+		__entry->len = len;
+		__entry->ns = ns;
+		__entry->ret = ret;
+	),
+	TP_printk("addr=0x%02x %s reg=0x%02x len=%zu ns=%llu ret=%d",
+		  __entry->addr, __entry->write ? "write" : "read", __entry->reg,
+		  __entry->len, __entry->ns, __entry->ret)
+);
+
+/* a range result reached the driver: latency since IRQ or request */
+TRACE_EVENT(vl53l0x_sample,
+	TP_PROTO(u16 addr, u16 range, s64 latency_ns),
+	TP_ARGS(addr, range, latency_ns),
+	TP_STRUCT__entry(
+		__field(u16, addr)
+		__field(u16, range)
+		__field(s64, latency_ns)
+	),
+	TP_fast_assign(
+		__entry->addr = addr;
+		__entry->range = range;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk("addr=0x%02x range=%u latency_ns=%lld",
+		  __entry->addr, __entry->range, __entry->latency_ns)
+);
+
+#endif /* _VL53L0X_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE vl53l0x_trace
+#include <trace/define_trace.h>